@@ -0,0 +1,120 @@
+#include "TapeClock.h"
+
+#include <cmath>
+
+namespace tape {
+
+// Loop gains: how much of an edge's miss goes into the beat's phase and
+// into its period
+static constexpr float kPhaseGain = 0.125f;
+static constexpr float kPeriodGain = 0.015625f;
+// An interval further than this from the period is a tempo change
+static constexpr float kOffTempo = 0.15f;
+
+ClockRatio ClockRatio::FromKnob(float knob) {
+    static const ClockRatio ratios[] = {
+        {1, 8}, {1, 6}, {1, 4}, {1, 3}, {3, 8}, {1, 2}, {2, 3}, {3, 4},
+        {1, 1}, {3, 2}, {2, 1}, {3, 1}, {4, 1},
+    };
+    constexpr int count = sizeof(ratios) / sizeof(ratios[0]);
+    int k = static_cast<int>(knob * static_cast<float>(count));
+    k = k < 0 ? 0 : (k >= count ? count - 1 : k);
+    return ratios[k];
+}
+
+void ClockTracker::Init(float sample_rate) {
+    sample_rate_ = sample_rate;
+    // Accepted between 40 ms and 3 s apart; lost after 3.5 s without one
+    min_interval_ = 0.04f * sample_rate;
+    max_interval_ = 3.0f * sample_rate;
+    timeout_ = 3.5f * sample_rate;
+
+    locked_ = false;
+    period_ = 0.5f * sample_rate;
+    phase_ = since_edge_ = last_interval_ = 0.0f;
+    off_tempo_ = 0;
+    ratio_ = pending_ = {1, 1};
+    count_ = 0;
+    beat_ = -1;
+    downbeat_ = false;
+}
+
+void ClockTracker::Advance(float len, int base) {
+    // Periods are longer than any block, so at most one beat per call.
+    // Sample base + i ends phase_ + i + 1 samples after the last beat.
+    const float to_beat = ceilf(period_ - phase_) - 1.0f;
+    phase_ += len;
+    if (phase_ < period_) return;
+    phase_ -= period_;
+    beat_ = base + (to_beat > 0.0f ? static_cast<int>(to_beat) : 0);
+
+    if (pending_ != ratio_) {
+        ratio_ = pending_;
+        count_ = 0;
+    } else {
+        count_++;
+    }
+    downbeat_ = (count_ % static_cast<uint32_t>(ratio_.num)) == 0;
+}
+
+void ClockTracker::Lock(float interval, int edge) {
+    locked_ = true;
+    period_ = interval;
+    off_tempo_ = 0;
+    // The edge is a beat, and the echoes line up with it: its sample ends
+    // on phase 0
+    phase_ = -1.0f;
+    beat_ = edge;
+    ratio_ = pending_;
+    count_ = 0;
+    downbeat_ = true;
+}
+
+void ClockTracker::Process(int edge, ClockRatio ratio, size_t n) {
+    beat_ = -1;
+    downbeat_ = false;
+    pending_ = ratio;
+    const float len = static_cast<float>(n);
+
+    if (edge < 0) {
+        if (locked_) Advance(len, 0);
+    } else {
+        const float at = static_cast<float>(edge);
+        if (locked_) Advance(at, 0);
+        const float interval = since_edge_ + at;
+        since_edge_ = -at;
+
+        if (interval >= min_interval_ && interval <= max_interval_) {
+            if (!locked_) {
+                // Two intervals that agree start the clock
+                if (fabsf(interval - last_interval_) < kOffTempo * interval) {
+                    Lock(0.5f * (interval + last_interval_), edge);
+                }
+            } else if (fabsf(interval - period_) > kOffTempo * period_) {
+                if (++off_tempo_ >= 2 && fabsf(interval - last_interval_) < kOffTempo * interval) {
+                    Lock(0.5f * (interval + last_interval_), edge);
+                }
+            } else {
+                // How far the edge is from the nearest beat of the tracker
+                // (the phase its sample would end on): positive when the
+                // tracker's beat came first
+                off_tempo_ = 0;
+                const float ph = phase_ + 1.0f;
+                const float miss = (ph < 0.5f * period_) ? ph : ph - period_;
+                phase_ -= kPhaseGain * miss;
+                period_ += kPeriodGain * miss;
+            }
+        }
+        last_interval_ = interval;
+
+        if (locked_) Advance(len - at, edge);
+    }
+
+    since_edge_ += len;
+    if (since_edge_ > timeout_) {
+        locked_ = false;
+        last_interval_ = 0.0f;
+    }
+}
+
+} // namespace tape
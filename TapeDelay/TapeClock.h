@@ -0,0 +1,79 @@
+/**
+ * External clock tracking for Gate In 1.
+ *
+ * Edges arrive as sample offsets into the audio block they were captured in
+ * (the firmware timestamps them with the cycle counter, see TapeDelay.cpp),
+ * so intervals are exact to the sample rather than to the millisecond.
+ *
+ * The tempo comes from a small phase-locked loop rather than the last
+ * interval. The tracker runs its own beat, one period after the other, and
+ * each edge nudges the beat's phase and period by a fraction of how far it
+ * missed. Clock jitter is averaged out, a steady clock gives a period that
+ * does not move at all, and so the echoes do not wobble in pitch. Two
+ * intervals in a row that are clearly off the current tempo count as a
+ * tempo change, and the loop re-locks to them at once.
+ *
+ * The delay is the period times a ratio picked with the Time knob (see
+ * ClockRatio). A new ratio takes effect on the next beat, which also
+ * restarts the count the gate and LED are aligned to.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tape {
+
+// Delay over one clock period for a Time knob position 0..1: divisions up
+// to the middle, then multiples
+struct ClockRatio {
+    int num, den;
+
+    static ClockRatio FromKnob(float knob);
+    float Value() const { return static_cast<float>(num) / static_cast<float>(den); }
+    bool operator!=(const ClockRatio &o) const { return num != o.num || den != o.den; }
+};
+
+class ClockTracker {
+  public:
+    void Init(float sample_rate);
+
+    // One block of n samples. `edge` is the sample of the block a clock edge
+    // arrived on, or -1; `ratio` the one the knob asks for.
+    void Process(int edge, ClockRatio ratio, size_t n);
+
+    bool Locked() const { return locked_; }
+    // Samples per clock period, filtered
+    float Period() const { return period_; }
+    // The ratio in force
+    ClockRatio Ratio() const { return ratio_; }
+    // Sample of the last block on which a beat of the tracker fell, or -1,
+    // and whether the echoes line up with the clock again there (every
+    // `num` beats of the ratio)
+    int Beat() const { return beat_; }
+    bool Downbeat() const { return downbeat_; }
+
+  private:
+    // Runs the beat on by len samples from sample `base` of the block
+    void Advance(float len, int base);
+    void Lock(float interval, int edge);
+
+    float sample_rate_ = 48000.0f;
+    float min_interval_ = 1920.0f, max_interval_ = 144000.0f, timeout_ = 168000.0f;
+
+    bool locked_ = false;
+    float period_ = 24000.0f;
+    float phase_ = 0.0f;        // samples since the tracker's last beat
+    float since_edge_ = 0.0f;   // samples since the last edge
+    float last_interval_ = 0.0f;
+    int off_tempo_ = 0;         // intervals in a row clearly off the period
+
+    ClockRatio ratio_ = {1, 1};
+    ClockRatio pending_ = {1, 1};
+    uint32_t count_ = 0;        // beats since the ratio last changed
+    int beat_ = -1;
+    bool downbeat_ = false;
+};
+
+} // namespace tape
@@ -0,0 +1,933 @@
+#include "TapeCore.h"
+
+#include <type_traits>
+
+#include "TapePlatform.h"
+
+namespace tape {
+
+float MapLog(float input, float min_freq, float max_freq) {
+    input = fclamp(input, 0.0f, 1.0f);
+    return min_freq * powf(max_freq / min_freq, input);
+}
+
+// --------------------------------------------------------------------------
+// TAPE HEAD
+// --------------------------------------------------------------------------
+
+void TapeHead::Init(float sr, TapeLine *line, size_t lane_index, size_t lane_skew,
+                    HeadShared *shared_state) {
+    tape = line;
+    lane = lane_index;
+    skew = lane_skew;
+    shared = shared_state;
+    trap.Init(sr);
+    fbLpFilter.Init(sr);
+    fbHpFilter.Init(sr);
+    feeder.Init(sr, shared->trap.FeederAttack(lane_index), FEEDER_DECAY);
+}
+
+// Runs f(integral_constant<Q>, integral_constant<NL>) for the active quality.
+// The curve only becomes a template argument at quality 2; below that it is
+// whatever the table holds.
+template <typename F>
+static void DispatchQuality(int quality, int nonlin, F &&f) {
+    using std::integral_constant;
+    using Q0 = integral_constant<int, QUALITY_LUT_COSINE>;
+    using Q1 = integral_constant<int, QUALITY_LUT_CUBIC>;
+    using Q2 = integral_constant<int, QUALITY_REALTIME>;
+    if (quality == QUALITY_LUT_CUBIC) {
+        f(Q1(), integral_constant<int, 0>());
+    } else if (quality == QUALITY_REALTIME) {
+        switch (nonlin) {
+            case NONLIN_POLY:      f(Q2(), integral_constant<int, NONLIN_POLY>()); break;
+            case NONLIN_CUBIC:     f(Q2(), integral_constant<int, NONLIN_CUBIC>()); break;
+            case NONLIN_PARABOLIC: f(Q2(), integral_constant<int, NONLIN_PARABOLIC>()); break;
+            default:               f(Q2(), integral_constant<int, NONLIN_TANH>()); break;
+        }
+    } else {
+        f(Q0(), integral_constant<int, 0>());
+    }
+}
+
+// Same for the oversampling factor
+template <typename F>
+static void DispatchFactor(int factor, F &&f) {
+    using std::integral_constant;
+    if (factor == 4) {
+        f(integral_constant<int, 4>());
+    } else if (factor == 2) {
+        f(integral_constant<int, 2>());
+    } else {
+        f(integral_constant<int, 1>());
+    }
+}
+
+// Runs f(policy) for an interpolator, INTERP_NONE..INTERP_HERMITE
+template <typename F>
+static void DispatchInterp(int interp, F &&f) {
+    switch (interp) {
+        case INTERP_NONE:    f(InterpNone()); break;
+        case INTERP_LINEAR:  f(InterpLinear()); break;
+        case INTERP_COSINE:  f(InterpCosine()); break;
+        case INTERP_CUBIC:   f(InterpCubic()); break;
+        default:             f(InterpHermite()); break;
+    }
+}
+
+template <int Q, int NL>
+inline float TapeHead::Saturate(float x, size_t i, DcBlock &dc) const {
+    if constexpr (Q == QUALITY_LUT_COSINE) {
+        // Static drive; 1.3 is the gen~ 1x pre-feed amp
+        return shared->sat.LookupCosine(x * 1.3f);
+    } else {
+        // Envelope-driven drive with more boost (gen~ 1.578 vs 1.333) to make
+        // up for the output compensation
+        const float drive = 1.3f * (1.578f / 1.333f);
+        const float in = x * (drive * shared->satPre[i]);
+        if constexpr (Q == QUALITY_LUT_CUBIC) {
+            return shared->sat.LookupCubic(in) * shared->satPost[i];
+        } else {
+            float y = SatRealtime<NL>(in, shared->satMod[i] + sat_mod_offset);
+            return dc.Process(y) * (SatRealtimeGain<NL>() * shared->satPost[i]);
+        }
+    }
+}
+
+template <int Q, int NL, int OS>
+inline float TapeHead::Drive(float x, size_t i, DcBlock &dc) {
+    if constexpr (OS == 1) {
+        return Saturate<Q, NL>(x, i, dc);
+    } else {
+        float up[OS];
+        os->Up<OS>(x, up);
+        for (int k = 0; k < OS; k++) up[k] = Saturate<Q, NL>(up[k], i, dc);
+        return os->Down<OS>(up);
+    }
+}
+
+template <int Q, int NL, int T, typename I>
+float TapeHead::ProcessSample(float in, float feedback_signal, float read_pos, const float *rev, size_t i) {
+
+    // 1. Process main delay
+    float fb_input_for_write = feedback_signal;
+    float saturated_signal;
+    switch (shared->os_factor) {
+        case 4:  saturated_signal = Drive<Q, NL, 4>(in + fb_input_for_write, i, sat_dc_); break;
+        case 2:  saturated_signal = Drive<Q, NL, 2>(in + fb_input_for_write, i, sat_dc_); break;
+        default: saturated_signal = Drive<Q, NL, 1>(in + fb_input_for_write, i, sat_dc_); break;
+    }
+    tape->Write(lane, i + skew, saturated_signal);
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_SAT_WRITE);
+    float tape_out = tape->Read<I>(lane, read_pos);
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_TAPE_READ);
+
+    // 2. Trap filters; in reverse they play the reverse head
+    float hp_out = trap.Sample<T>(rev ? rev[i] : tape_out, shared->trap, lane);
+    if (!rev) hp_out *= feed_[i];
+
+    // 3. DC Block & Soft Limit -> WET OUTPUT
+    float clean_delayed_signal = hp_out - dc_x + 0.995f * dc_y;
+    dc_x = hp_out; dc_y = clean_delayed_signal;
+    clean_delayed_signal = softStatic(clean_delayed_signal);
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_FILTERS);
+
+    // 4. Feedback: the wet output, or in reverse the forward head through
+    // the feedback path's own filters
+    next_feedback_signal = clean_delayed_signal;
+    if (rev) {
+        float fb_lp = fbLpFilter.Process(tape_out, shared->trap.lp, 0);
+        next_feedback_signal = fbHpFilter.Process(fb_lp, shared->trap.hp, 1);
+    }
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_REVERSE);
+
+    // Return the WET OUTPUT
+    return clean_delayed_signal;
+}
+
+template <int Q, int NL, int T, typename I>
+void TapeHead::SampleKernel(const float *in, const float *read, const float *rev, float *out, size_t n) {
+    if (!rev) feeder.Process(in, feed_, n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ProcessSample<Q, NL, T, I>(in[i], next_feedback_signal * fb_gain.At(i), read[i], rev, i);
+    }
+}
+
+template <int Q, int NL, int OS>
+void TapeHead::WriteKernel(const float *in, const float *fb_src, size_t n) {
+    // Sample i is fed the feedback of sample i - 1
+    DcBlock dc = sat_dc_;
+    float fb = next_feedback_signal;
+    for (size_t i = 0; i < n; i++) {
+        write_[i] = Drive<Q, NL, OS>(in[i] + fb * fb_gain.At(i), i, dc);
+        fb = fb_src[i];
+    }
+    tape->WriteBlock(lane, skew, write_, n);
+    next_feedback_signal = fb;
+    sat_dc_ = dc;
+}
+
+void TapeHead::ProcessSamples(const float *in, const float *read, const float *rev, float *out, size_t n,
+                              int interp) {
+    DispatchQuality(shared->quality, shared->sat.Nonlin(), [&](auto q, auto nl) {
+        DispatchTopology(shared->trap.Topology(), [&](auto t) {
+            DispatchInterp(interp, [&](auto in_) {
+                SampleKernel<decltype(q)::value, decltype(nl)::value, decltype(t)::value, decltype(in_)>(
+                    in, read, rev, out, n);
+            });
+        });
+    });
+}
+
+void TapeHead::Filter(const float *src, float *wet, size_t n, const float *gain) {
+    // Trap filters, one kernel per topology
+    DispatchTopology(shared->trap.Topology(), [&](auto t) {
+        trap.Process<decltype(t)::value>(src, wet, n, shared->trap, lane);
+    });
+    if (gain) {
+        for (size_t i = 0; i < n; i++) wet[i] *= gain[i];
+    }
+
+    // DC Block & Soft Limit
+    float x1 = dc_x, y1 = dc_y;
+    for (size_t i = 0; i < n; i++) {
+        const float x = wet[i];
+        y1 = x - x1 + 0.995f * y1;
+        x1 = x;
+        wet[i] = softStatic(y1);
+    }
+    dc_x = x1; dc_y = y1;
+}
+
+void TapeHead::Flush() {
+    trap.Flush();
+    fbLpFilter.Flush();
+    fbHpFilter.Flush();
+    dc_x = fixdenorm(dc_x);
+    dc_y = fixdenorm(dc_y);
+    sat_dc_.Flush();
+    feeder.Flush();
+    next_feedback_signal = fixdenorm(next_feedback_signal);
+}
+
+void TapeHead::ProcessBlock(const float *in, float *wet, const float *rev, size_t n) {
+    // 1. Feedback source: the wet output, or in reverse the forward read
+    // through the feedback path's own filters (gen~ feeds back the dry
+    // play heads, so the loop itself keeps running forwards)
+    const float *fb_src = wet;
+    if (rev) {
+        fbLpFilter.ProcessBlock(wet, feedback_, n, shared->trap.lp, 0);
+        fbHpFilter.ProcessBlock(feedback_, feedback_, n, shared->trap.hp, 1);
+        fb_src = feedback_;
+    }
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_REVERSE);
+
+    // 2. Filters, DC block & soft limit -> WET OUTPUT; on the reverse head
+    // in reverse, which loses the feeder expansion (gen~ routing)
+    if (rev) {
+        Filter(rev, wet, n);
+    } else {
+        feeder.Process(in, feed_, n);
+        Filter(wet, wet, n, feed_);
+    }
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_FILTERS);
+
+    // 3. Saturation + write
+    DispatchQuality(shared->quality, shared->sat.Nonlin(), [&](auto q, auto nl) {
+        DispatchFactor(shared->os_factor, [&](auto f) {
+            WriteKernel<decltype(q)::value, decltype(nl)::value, decltype(f)::value>(in, fb_src, n);
+        });
+    });
+    TAPE_PROFILE_MARK(&shared->prof, CpuProfiler::STAGE_SAT_WRITE);
+}
+
+// --------------------------------------------------------------------------
+// CORE
+// --------------------------------------------------------------------------
+
+// Oversampling filter state and coefficients, zero-wait-state on the M7
+static Oversampler TAPE_DTCM_BSS oversamplers[2];
+
+void TapeDelayCore::Init(float sample_rate, TapeLine *tape) {
+    sample_rate_ = sample_rate;
+
+    tape_ = tape;
+    tape_->Init();
+    shared_.trap.Init(sample_rate_, SAT_CHARACTER);
+    shared_.sat.Init(NONLIN_TANH);
+    shared_.env.Init(sample_rate_);
+    heads_[0].Init(sample_rate_, tape_, 0, 0, &shared_);
+    heads_[1].Init(sample_rate_, tape_, 1, STEREO_OFFSET, &shared_);
+    for (int i = 0; i < 2; i++) {
+        oversamplers[i].Init();
+        heads_[i].os = &oversamplers[i];
+    }
+    prefetch_.Init();
+
+    // Playing forwards on an empty tape
+    reverse_mode_ = freeze_mode_ = false;
+    hold_dist_ = 0.0f;
+    rev_phase_ = rev_length_ = 0.0f;
+    delayGlide_.Init(sample_rate_, DELAY_GLIDE_MS);
+    delayGlide_.Reset(24000.0f);
+
+    flutter_.Init(sample_rate_);
+    clock_.Init(sample_rate_);
+
+    Hysteresis *knobs[] = {&knobTime_, &knobFeedback_, &knobMix_, &knobTone_, &knobFlutter_};
+    for (Hysteresis *k : knobs) k->Init(KNOB_HYSTERESIS);
+    fbSmooth_.Init(sample_rate_, 0.999f);
+    mixSmooth_.Init(sample_rate_, 0.999f);
+    flutterSmooth_.Init(sample_rate_, 0.9995f);
+    params_primed_ = false;
+}
+
+void TapeDelayCore::SetQuality(int quality) {
+    shared_.quality = (quality >= 0 && quality < QUALITY_COUNT) ? quality : QUALITY_LUT_COSINE;
+}
+
+void TapeDelayCore::SetOversampling(int factor) {
+    os_request_ = (factor == 2 || factor == 4) ? factor : 1;
+}
+
+void TapeDelayCore::SetTopology(int topology) {
+    topology_request_ = (topology >= 0 && topology < TOPOLOGY_COUNT) ? topology : TOPOLOGY_201;
+}
+
+void TapeDelayCore::SetHeadMode(int mode) {
+    head_mode_ = (mode >= 1 && mode <= HEAD_MODE_COUNT) ? mode : 1;
+}
+
+void TapeDelayCore::SetReverseStyle(int style) {
+    reverse_style_ = (style >= 0 && style < REVERSE_STYLE_COUNT) ? style : REVERSE_LOOP;
+}
+
+void TapeDelayCore::SetInterp(int interp) {
+    interp_ = (interp >= 0 && interp < INTERP_COUNT) ? interp : INTERP_AUTO;
+}
+
+void TapeDelayCore::ProcessControls(const ControlFrame &ctl) {
+    const bool was_frozen = freeze_mode_;
+
+    // Oversampling changes: start the new factor from clean filters
+    const int factor = os_request_;
+    if (factor != shared_.os_factor) {
+        oversamplers[0].Reset();
+        oversamplers[1].Reset();
+        shared_.os_factor = factor;
+        shared_.os_latency = Oversampler::Latency(factor);
+    }
+
+    // Topology changes: start the new kernel from clean filters, with the
+    // feeder attacks that go with it
+    const int topology = topology_request_;
+    if (topology != shared_.trap.Topology()) {
+        shared_.trap.SetTopology(topology);
+        for (size_t ch = 0; ch < 2; ch++) {
+            heads_[ch].trap.Reset();
+            heads_[ch].feeder.SetTimes(shared_.trap.FeederAttack(ch), FEEDER_DECAY);
+        }
+    }
+
+    // Reverse Mode Button (D2)
+    if (ctl.reverse_pressed) {
+        reverse_mode_ = !reverse_mode_;
+        // If reverse is engaged, ensure freeze is off
+        if (reverse_mode_) {
+             freeze_mode_ = false;
+        }
+        // Start the reverse heads on a fresh loop
+        rev_phase_ = rev_length_ = 0.0f;
+    }
+
+    // Freeze Button (D1)
+    if (ctl.freeze_pressed) {
+        freeze_mode_ = !freeze_mode_;
+        // If freeze is engaged, ensure reverse is off
+        if (freeze_mode_) {
+             reverse_mode_ = false;
+             // The loop starts where the play head would read next, just
+             // behind the stopped write pointer, and runs up to it
+             hold_top_ = fmaxf(delayGlide_.Value() - 1.0f - shared_.os_latency, 3.0f);
+             // A whole number of frames, so every pass reads the same
+             // positions and the loop neither drifts nor dulls
+             hold_length_ = floorf(hold_top_ - 2.0f);
+             hold_phase_ = hold_behind_ = 0.0f;
+             hold_first_ = true;
+             // gen~ shortens the edge fades of loops under 10000 samples and
+             // keeps them from dipping all the way
+             const float r = fminf(delayGlide_.Value() / 10000.0f, 1.0f);
+             hold_ramp_ = 0.05f * powf(r, 2.438f);
+             hold_lo_ = fclamp(1.0f - r * r, 0.0f, 0.501f);
+        }
+    }
+
+    // Keep holdsmooth where it was, now relative to the new target
+    if (freeze_mode_ != was_frozen) hold_dist_ += freeze_mode_ ? -1.0f : 1.0f;
+
+    // Knobs: whatever hangs off one is only recomputed when it moves
+    if (knobTime_.Process(ctl.time)) {
+        const float raw_time = fclamp(knobTime_.Value(), 0.0f, 1.0f);
+        knob_delay_ms_ = 10.0f + (powf(raw_time, 2.5f) * 1500.0f);
+        clock_ratio_ = ClockRatio::FromKnob(raw_time);
+    }
+    if (knobFeedback_.Process(ctl.feedback)) {
+        fb_target_ = fclamp(knobFeedback_.Value() * 1.1f, 0.0f, 1.2f);
+        // Saturation envelope (quality 1 and 2); the right channel's
+        // modifier is skewed against the left
+        shared_.env.SetParams(SAT_CHARACTER, fclamp(knobFeedback_.Value(), 0.0f, 1.0f));
+        shared_.trap.SetIntensity(fclamp(knobFeedback_.Value(), 0.0f, 1.0f));
+        heads_[1].sat_mod_offset = -shared_.env.Skew();
+    }
+    if (knobMix_.Process(ctl.mix)) mix_target_ = fclamp(knobMix_.Value(), 0.0f, 1.0f);
+    if (knobTone_.Process(ctl.tone)) shared_.trap.SetTone(MapLog(knobTone_.Value(), 400.0f, 18000.0f));
+    if (knobFlutter_.Process(ctl.flutter)) flutter_target_ = fclamp(knobFlutter_.Value(), 0.0f, 1.0f) * 60.0f;
+
+    if (!params_primed_) {
+        fbSmooth_.Reset(fb_target_);
+        mixSmooth_.Reset(mix_target_);
+        flutterSmooth_.Reset(flutter_target_);
+        shared_.trap.Reset();
+        params_primed_ = true;
+    }
+}
+
+// Furthest back any read may go: the taps and the right lane's skew stay on
+// the tape
+static const float kReadReach = static_cast<float>(MAX_DELAY - STEREO_OFFSET) - 100.0f;
+
+// gen~ reversestyle 0/1. At the start of each loop the head sits just
+// behind the newest sample on tape; from there it moves back one frame per
+// sample while the write head moves forward one, so it plays what was
+// recorded before the loop started, backwards. A trapezoid (gen~ hTrap)
+// fades each loop in and out. Loop lengths are latched at the loop start
+// from the unsmoothed delay, as in gen~ (postMasterDelay).
+void TapeDelayCore::ReverseMotion(float target_delay, const float *wobble, size_t n) {
+    const bool sweep = reverse_style_ == REVERSE_SWEEP;
+    const float ramp = sweep ? 0.077f : 0.04f;   // gen~ tramp
+    for (size_t i = 0; i < n; i++) {
+        if (rev_phase_ >= rev_length_) {
+            // Reads are relative to the write pointer at the block start, so
+            // the newest frame on tape is i + 1 behind sample i; the first
+            // Hermite tap needs one more
+            rev_start_ = static_cast<float>(i) + 3.0f;
+            const float longest = floorf((kReadReach - rev_start_) * 0.5f);
+            rev_length_ = sweep ? longest : fclamp(floorf(target_delay), 1.0f, longest);
+            rev_phase_ = 0.0f;
+        }
+        // Twice the loop phase behind this sample's write, plus the flutter.
+        // Heads 2 and 3 play what head 1 played one and two loops ago.
+        const float w = wobble ? wobble[i] : 0.0f;
+        const float d = 2.0f * rev_phase_ + rev_start_ + w - static_cast<float>(i + 1);
+        revRead_[i] = fclamp(d, 2.0f, kReadReach);
+        revHop_[i] = sweep ? hop_[i] : rev_length_;
+        revGain_[i] = hTrap(rev_phase_ / rev_length_, 0.0f, 1.0f, ramp, 1.0f - ramp);
+        rev_phase_ += 1.0f;
+    }
+}
+
+// gen~ Hold. The loop plays forwards from hold_top_ behind the stopped write
+// pointer up to 2 behind it (the newest frame with all four Hermite taps on
+// tape), then jumps back. The jump is hidden by a trapezoid (gen~ multrap),
+// except at the start of the first pass, which carries straight on from the
+// play head.
+void TapeDelayCore::HoldMotion(size_t n, bool running) {
+    for (size_t i = 0; i < n; i++) {
+        if (hold_phase_ >= hold_length_) {
+            hold_phase_ -= hold_length_;
+            hold_first_ = false;
+        }
+        // Reads are relative to the write pointer at the block start, which
+        // only moves on again once the hold is released
+        const float d = hold_top_ - hold_phase_ + hold_behind_;
+        holdRead_[i] = (d < kReadReach) ? d : kReadReach;
+        const float ph = hold_phase_ / hold_length_;
+        holdGain_[i] = (hold_first_ && ph < 0.5f)
+                           ? 1.0f
+                           : hTrap(ph, hold_lo_, 1.0f, hold_ramp_, 1.0f - hold_ramp_);
+        hold_phase_ += 1.0f;
+    }
+    if (running) hold_behind_ += static_cast<float>(n);
+}
+
+// --------------------------------------------------------------------------
+// HEAD MODES (gen~ Mode selector)
+// --------------------------------------------------------------------------
+
+// Whether head 1, 2 or 3 is heard in a mode
+static constexpr bool PlaysHead(int mode, int head) {
+    switch (head) {
+        case 1:  return mode == 1 || mode == 5 || mode == 8 || mode == 10 || mode == 11;
+        case 2:  return mode == 2 || mode == 4 || mode == 6 || mode == 8 || mode == 9 || mode == 11;
+        default: return mode == 3 || mode == 4 || mode == 7 || mode == 9 || mode == 10 || mode == 11;
+    }
+}
+
+// Head sums
+static inline float plus2A(float a, float b) { return (a + b) * 0.6f; }
+static inline float plus2B(float a, float b) { return (a + b) * 0.4f; }
+static inline float plus2C(float a, float b) { return (a * 0.435f) + (b * 0.665f); }
+static inline float plus2D(float a, float b) { return (a + b) * 0.55f; }
+
+// Runs f(integral_constant<mode>) for a head mode
+template <typename F>
+static void DispatchMode(int mode, F &&f) {
+    using std::integral_constant;
+    switch (mode) {
+        case 2:  f(integral_constant<int, 2>()); break;
+        case 3:  f(integral_constant<int, 3>()); break;
+        case 4:  f(integral_constant<int, 4>()); break;
+        case 5:  f(integral_constant<int, 5>()); break;
+        case 6:  f(integral_constant<int, 6>()); break;
+        case 7:  f(integral_constant<int, 7>()); break;
+        case 8:  f(integral_constant<int, 8>()); break;
+        case 9:  f(integral_constant<int, 9>()); break;
+        case 10: f(integral_constant<int, 10>()); break;
+        case 11: f(integral_constant<int, 11>()); break;
+        case 12: f(integral_constant<int, 12>()); break;
+        default: f(integral_constant<int, 1>()); break;
+    }
+}
+
+// --------------------------------------------------------------------------
+// INTERPOLATION
+// --------------------------------------------------------------------------
+
+// Whether every one of n read positions is within 1/1000 of a whole sample
+static bool WholeSamples(const float *pos, size_t n) {
+    bool whole = true;
+    for (size_t i = 0; i < n; i++) whole &= fabsf(pos[i] - roundf(pos[i])) < 0.001f;
+    return whole;
+}
+
+// What auto reads a block of a forward head with (see Interp). Positions
+// step back one sample per sample at tape speed; the slew is how far the
+// block's average step is off that.
+static int AutoInterp(const float *pos, size_t n, bool whole) {
+    if (whole) return INTERP_NONE;
+    const float step = (n > 1) ? (pos[n - 1] - pos[0]) / static_cast<float>(n - 1) : -1.0f;
+    return (fabsf(step + 1.0f) > INTERP_FAST_SLEW) ? INTERP_LINEAR : INTERP_HERMITE;
+}
+
+// --------------------------------------------------------------------------
+// HEAD READS
+// --------------------------------------------------------------------------
+
+// gen~ feeds head 2 from a delay line written by head 1 and head 3 from one
+// written by head 2 with the sides swapped, each read at the delay time.
+// On the shared tape that is the same signal one and two delay times
+// further back, so:
+//   TH2L / TH2R   left / right lane one hop behind head 1
+//   TH3R / TH3L   left / right lane two hops behind (the swap)
+// Modes 2, 6 and 7 nudge one side of head 2 (and so of head 3) by 404
+// samples.
+template <int M, typename I>
+void TapeDelayCore::ReadHeads(const TapeWindow<TapeLine::Sample> *window, const float *pos,
+                              const float *posR, const float *hop, const float *gain, float *l, float *r,
+                              size_t n) {
+    constexpr bool h1 = PlaysHead(M, 1), h2 = PlaysHead(M, 2), h3 = PlaysHead(M, 3);
+
+    if constexpr (h1) {
+        // Stereo read: both channels' taps come from the same frames, unless
+        // the flutter skews the right lane
+        if (posR) {
+            if (window) {
+                for (size_t i = 0; i < n; i++) {
+                    l[i] = window->template Read<I>(0, pos[i]);
+                    r[i] = window->template Read<I>(1, posR[i]);
+                }
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    l[i] = tape_->template Read<I>(0, pos[i]);
+                    r[i] = tape_->template Read<I>(1, posR[i]);
+                }
+            }
+        } else if (window) {
+            for (size_t i = 0; i < n; i++) window->template Read<I>(pos[i], l[i], r[i]);
+        } else {
+            for (size_t i = 0; i < n; i++) tape_->template Read<I>(pos[i], l[i], r[i]);
+        }
+    }
+
+    if constexpr (h2 || h3) {
+        constexpr float offL = (M == 6) ? 404.0f : 0.0f;
+        constexpr float offR = (M == 2 || M == 7) ? -404.0f : 0.0f;
+        constexpr bool split = offL != offR;
+        // One stereo read where both sides sit at the same place, else one per lane
+        auto read = [&](float p, float &a, float &b) {
+            if constexpr (split) {
+                a = tape_->template Read<I>(0, fclamp(p + offL, 2.0f, kReadReach));
+                b = tape_->template Read<I>(1, fclamp(p + offR, 2.0f, kReadReach));
+            } else {
+                tape_->template Read<I>(fclamp(p, 2.0f, kReadReach), a, b);
+            }
+        };
+        for (size_t i = 0; i < n; i++) {
+            float t2l = 0.0f, t2r = 0.0f, t3l = 0.0f, t3r = 0.0f;
+            if constexpr (h2) read(pos[i] + hop[i], t2l, t2r);
+            if constexpr (h3) read(pos[i] + 2.0f * hop[i], t3r, t3l);
+            if constexpr (M == 2 || M == 6) {
+                l[i] = t2r;
+                r[i] = t2l;
+            } else if constexpr (M == 3 || M == 7) {
+                l[i] = t3r;
+                r[i] = t3l;
+            } else if constexpr (M == 4) {
+                l[i] = plus2A(t2r, t3r);
+                r[i] = plus2A(t2l, t3l);
+            } else if constexpr (M == 8) {
+                l[i] = plus2A(l[i], t2r);
+                r[i] = plus2C(r[i], t2l);
+            } else if constexpr (M == 9) {
+                l[i] = plus2A(t2r, t3r);
+                r[i] = plus2C(t2l, t3l);
+            } else if constexpr (M == 10) {
+                l[i] = plus2A(l[i], t3r);
+                r[i] = plus2C(r[i], t3l);
+            } else {   // 11
+                l[i] = plus2B((l[i] + t2r) * 0.666667f, t3r);
+                r[i] = plus2D(plus2C(r[i], t2l), t3l);
+            }
+        }
+    }
+
+    if constexpr (!h1 && !h2 && !h3) {
+        for (size_t i = 0; i < n; i++) l[i] = r[i] = 0.0f;
+    } else {
+        if (gain) {
+            for (size_t i = 0; i < n; i++) {
+                l[i] *= gain[i];
+                r[i] *= gain[i];
+            }
+        }
+    }
+}
+
+void TapeDelayCore::Process(const ControlFrame &ctl, const float *const *in, float **out, size_t size) {
+    ProcessControls(ctl);
+
+    // ----------------------
+    // 1. CLOCK / SYNC LOGIC
+    // ----------------------
+    int edge = -1;
+    if (ctl.clock_trig) edge = static_cast<int>(ctl.clock_offset < size ? ctl.clock_offset : size - 1);
+    clock_.Process(edge, clock_ratio_, size);
+
+    // ----------------------
+    // 2. PARAMETER CALCULATIONS
+    // ----------------------
+
+    // The knobs themselves are read in ProcessControls(). Synced, the Time
+    // knob picks a ratio of the clock period instead, halved until the tape
+    // holds it.
+    float target_delay_samps;
+    if (clock_.Locked()) {
+        const float longest = static_cast<float>(MAX_DELAY - STEREO_OFFSET) - 100.0f;
+        target_delay_samps = clock_.Period() * clock_.Ratio().Value();
+        while (target_delay_samps > longest) target_delay_samps *= 0.5f;
+        current_delay_ms_ = target_delay_samps * (1000.0f / sample_rate_);
+    } else {
+        current_delay_ms_ = knob_delay_ms_;
+        target_delay_samps = (current_delay_ms_ / 1000.0f) * sample_rate_;
+    }
+    // Where the gate and LED line up with the clock again in this callback
+    const int downbeat = clock_.Downbeat() ? clock_.Beat() : -1;
+    const bool sat_env = shared_.quality != QUALITY_LUT_COSINE;
+
+    TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_CONTROLS);
+
+    // ----------------------
+    // 3. AUDIO LOOP
+    // ----------------------
+    for (size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE) {
+        const size_t n = (size - offset < MAX_BLOCK_SIZE) ? size - offset : MAX_BLOCK_SIZE;
+        shared_.trap.Update(n);
+
+        // Per-sample glides of the parameters that would otherwise step
+        heads_[0].fb_gain = heads_[1].fb_gain = fbSmooth_.Advance(fb_target_, n);
+        const Ramp dry_wet = mixSmooth_.Advance(mix_target_, n);
+        const Ramp flutter_depth = flutterSmooth_.Advance(flutter_target_, n);
+
+        const float *inL = in[0] + offset;
+        const float *inR = in[1] + offset;
+        float *outL = out[0] + offset;
+        float *outR = out[1] + offset;
+
+        // Hold smoothing (gen~ holdsmooth), per sample only while it moves
+        const float hold_target = freeze_mode_ ? 1.0f : 0.0f;
+        const bool hold_fade = hold_dist_ != 0.0f;
+        if (hold_fade) {
+            float d = hold_dist_;
+            for (size_t i = 0; i < n; i++) {
+                d *= 0.9995f;
+                holdMix_[i] = hold_target + d;
+            }
+            // Within -96 dB of the target counts as there, as in gen~
+            hold_dist_ = (fabsf(d) < 0.000016f) ? 0.0f : d;
+        }
+
+        // Hold loop. Every head would play the same loop (gen~ hscale evens
+        // out the mode sums in hold), so it is one stereo read, with the
+        // sides swapped in the modes head 1 is not in.
+        if (freeze_mode_ || hold_fade) {
+            HoldMotion(n, !freeze_mode_);
+            const int mode = head_mode_;
+            if (mode == HEAD_MODE_COUNT) {
+                for (size_t i = 0; i < n; i++) holdL_[i] = holdR_[i] = 0.0f;
+            } else {
+                const bool swap = !PlaysHead(mode, 1);
+                const int interp = (interp_ == INTERP_AUTO)
+                                       ? AutoInterp(holdRead_, n, WholeSamples(holdRead_, n))
+                                       : interp_;
+                DispatchInterp(interp, [&](auto in) {
+                    ReadHeads<1, decltype(in)>(nullptr, holdRead_, nullptr, holdRead_, holdGain_,
+                                               swap ? holdR_ : holdL_, swap ? holdL_ : holdR_, n);
+                });
+            }
+            TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_TAPE_READ);
+        }
+
+        if (freeze_mode_) {
+            // Held: no writes, no saturation, and the tape stays where it
+            // is. The loop only goes through the filters while it fades in.
+            if (hold_fade) {
+                heads_[0].Filter(holdL_, wetL_, n);
+                heads_[1].Filter(holdR_, wetR_, n);
+                for (size_t i = 0; i < n; i++) {
+                    wetL_[i] += holdMix_[i] * (holdL_[i] - wetL_[i]);
+                    wetR_[i] += holdMix_[i] * (holdR_[i] - wetR_[i]);
+                }
+                TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_FILTERS);
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    wetL_[i] = holdL_[i];
+                    wetR_[i] = holdR_[i];
+                }
+            }
+        } else {
+            // Flutter Modulation (none at zero depth): the wobble into
+            // wobble_, the right head's extra into readR_. The right channel
+            // reads STEREO_OFFSET later through its skewed writes, so the
+            // left delay leaves room for it.
+            const bool skewed = flutter_.Process(flutter_depth, wobble_, readR_, n);
+            const float max_delay = (float)(MAX_DELAY - STEREO_OFFSET) - 100.0f;
+            const float lead = shared_.os_latency;
+
+            // --- DELAY GLIDE ---
+            // The delay glides to the target once per block and ramps
+            // linearly across it; the wobble rides on top. Auto interpolation
+            // puts a standing delay on a whole sample of the read (the
+            // oversampler's latency included).
+            float d = fclamp(target_delay_samps, 10.0f, max_delay);
+            if (interp_ == INTERP_AUTO && !skewed) d = roundf(d - lead) + lead;
+            const Ramp glide = delayGlide_.Advance(d, n, 0.001f);
+
+            // After i + 1 writes the write pointer would have moved i + 1 slots, so
+            // sample i reads (delay - (i + 1)) from where the pointer is at the
+            // start of the block; reads also come early by the oversampler's
+            // latency. When all four taps of every read are older than the
+            // block (floor(read) - 1 >= 1) the whole block can be read first.
+            const float first_read = glide.from - lead;
+            const float slope = glide.step - 1.0f;
+            float margin, reach;
+            if (skewed) {
+                // The glide stays between its ends, so the wobble's extremes
+                // say whether any sample needs the bounds
+                float lo = wobble_[0], hi = wobble_[0];
+                for (size_t i = 1; i < n; i++) {
+                    lo = fminf(lo, wobble_[i]);
+                    hi = fmaxf(hi, wobble_[i]);
+                }
+                const float g0 = glide.from, g1 = glide.At(n - 1);
+                if (fminf(g0, g1) + lo < 10.0f || fmaxf(g0, g1) + hi > max_delay) {
+                    for (size_t i = 0; i < n; i++) hop_[i] = fclamp(glide.At(i) + wobble_[i], 10.0f, max_delay);
+                } else {
+                    for (size_t i = 0; i < n; i++) hop_[i] = glide.At(i) + wobble_[i];
+                }
+                margin = kReadReach;
+                reach = 0.0f;
+                for (size_t i = 0; i < n; i++) {
+                    read_[i] = hop_[i] - static_cast<float>(i + 1) - lead;
+                    const float rr = fclamp(read_[i] + readR_[i], 1.0f, kReadReach);
+                    readR_[i] = rr;
+                    margin = fminf(margin, fminf(read_[i], rr));
+                    reach = fmaxf(reach, fmaxf(read_[i], rr));
+                }
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    hop_[i] = glide.At(i);
+                    read_[i] = first_read + slope * static_cast<float>(i + 1);
+                }
+                margin = fminf(read_[0], read_[n - 1]);
+                reach = fmaxf(read_[0], read_[n - 1]);
+            }
+            const float *posR = skewed ? readR_ : nullptr;
+
+            // Heads played forwards: in reverse only head 1, which feeds back
+            const int mode = head_mode_;
+            const int forward_mode = reverse_mode_ ? 1 : mode;
+
+            // Copy the frames head 1 reads (first tap of the shortest read to
+            // last tap of the longest) into DTCM while the envelope runs. Spans
+            // that wrap or outgrow the staging buffer are read in place.
+            using Sample = TapeLine::Sample;
+            TapeWindow<Sample> window = {nullptr, 0};
+            if (prefetch_on_ && margin >= 2.0f && PlaysHead(forward_mode, 1)) {
+                const int32_t first = static_cast<int32_t>(margin) - 1;
+                const size_t count = static_cast<size_t>(static_cast<int32_t>(reach) + 3 - first);
+                const size_t bytes = count * 2 * sizeof(Sample);
+                const Sample *src = (bytes <= ReadPrefetch::BYTES) ? tape_->Frames(first, count) : nullptr;
+                if (src) {
+                    prefetch_.Start(src, bytes);
+                    window = {static_cast<const Sample *>(prefetch_.Staging()), first};
+                }
+            }
+
+            // Reverse heads, all on tape written before the block
+            if (reverse_mode_) {
+                // The reverse head takes the flutter alone, not the glide
+                ReverseMotion(target_delay_samps, skewed ? wobble_ : nullptr, n);
+                const int interp = (interp_ == INTERP_AUTO) ? INTERP_COSINE : interp_;
+                DispatchMode(mode, [&](auto m) {
+                    DispatchInterp(interp, [&](auto in) {
+                        ReadHeads<decltype(m)::value, decltype(in)>(nullptr, revRead_, nullptr, revHop_, revGain_,
+                                                                    revL_, revR_, n);
+                    });
+                });
+            }
+            const float *revL = reverse_mode_ ? revL_ : nullptr;
+            const float *revR = reverse_mode_ ? revR_ : nullptr;
+            TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_TAPE_READ);
+
+            if (sat_env) {
+                shared_.env.Process(inL, inR, shared_.satPre, shared_.satPost, shared_.satMod, n);
+                TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_SAT_WRITE);
+            }
+
+            // Tape Process -> WET OUTPUT. While the hold loop fades out the
+            // input fades in (gen~ invhs).
+            const float *tapeInL = inL, *tapeInR = inR;
+            if (hold_fade) {
+                for (size_t i = 0; i < n; i++) {
+                    dryL_[i] = inL[i] * (1.0f - holdMix_[i]);
+                    dryR_[i] = inR[i] * (1.0f - holdMix_[i]);
+                }
+                tapeInL = dryL_;
+                tapeInR = dryR_;
+            }
+            if (margin >= 2.0f) {
+                // The mode's kernel is picked once per block and reads only the
+                // heads it plays
+                // A failed copy falls back to the in-place read
+                if (window.frames && !prefetch_.Wait()) {
+                    shared_.prof.CountPrefetchFail();
+                    window.frames = nullptr;
+                }
+                const TapeWindow<Sample> *win = window.frames ? &window : nullptr;
+                int interp = interp_;
+                if (interp == INTERP_AUTO) {
+                    // Never under flutter (the right lane is skewed); heads 2
+                    // and 3 land on whole samples too if the hop does
+                    const bool far = PlaysHead(forward_mode, 2) || PlaysHead(forward_mode, 3);
+                    const bool whole = !posR && WholeSamples(read_, n) && (!far || WholeSamples(hop_, n));
+                    interp = AutoInterp(read_, n, whole);
+                }
+                DispatchMode(forward_mode, [&](auto m) {
+                    DispatchInterp(interp, [&](auto in) {
+                        ReadHeads<decltype(m)::value, decltype(in)>(win, read_, posR, hop_, nullptr, wetL_, wetR_, n);
+                    });
+                });
+                TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_TAPE_READ);
+                heads_[0].ProcessBlock(tapeInL, wetL_, revL, n);
+                heads_[1].ProcessBlock(tapeInR, wetR_, revR, n);
+            } else {
+                // Delay shorter than the block: the loop needs per-sample recursion
+                // and plays head 1 only, read with the same policy as above
+                int interp = interp_;
+                if (interp == INTERP_AUTO) interp = AutoInterp(read_, n, !posR && WholeSamples(read_, n));
+                heads_[0].ProcessSamples(tapeInL, read_, revL, wetL_, n, interp);
+                heads_[1].ProcessSamples(tapeInR, posR ? posR : read_, revR, wetR_, n, interp);
+            }
+            tape_->Advance(n);
+            if (hold_fade) {
+                for (size_t i = 0; i < n; i++) {
+                    wetL_[i] += holdMix_[i] * (holdL_[i] - wetL_[i]);
+                    wetR_[i] += holdMix_[i] * (holdR_[i] - wetR_[i]);
+                }
+            }
+        }
+
+        // Hold fades the dry signal out with the input
+        if (hold_fade) {
+            for (size_t i = 0; i < n; i++) {
+                const float mix = dry_wet.At(i);
+                const float dw = mix + (1.0f - mix) * holdMix_[i];
+                outL[i] = (inL[i] * (1.0f - dw)) + (wetL_[i] * dw);
+                outR[i] = (inR[i] * (1.0f - dw)) + (wetR_[i] * dw);
+            }
+        } else if (dry_wet.Moving() && !freeze_mode_) {
+            for (size_t i = 0; i < n; i++) {
+                const float dw = dry_wet.At(i);
+                outL[i] = (inL[i] * (1.0f - dw)) + (wetL_[i] * dw);
+                outR[i] = (inR[i] * (1.0f - dw)) + (wetR_[i] * dw);
+            }
+        } else {
+            const float dw = freeze_mode_ ? 1.0f : dry_wet.from;
+            for (size_t i = 0; i < n; i++) {
+                outL[i] = (inL[i] * (1.0f - dw)) + (wetL_[i] * dw);
+                outR[i] = (inR[i] * (1.0f - dw)) + (wetR_[i] * dw);
+            }
+        }
+
+        // Output level for the LED, from every 4th frame: plenty for a glow
+        float peak = level_peak_;
+        for (size_t i = 0; i < n; i += 4) {
+            const float l = fabsf(outL[i]), r = fabsf(outR[i]);
+            peak = (l > peak) ? l : peak;
+            peak = (r > peak) ? r : peak;
+        }
+        level_peak_ = peak;
+        TAPE_PROFILE_MARK(&shared_.prof, CpuProfiler::STAGE_MIX);
+    }
+
+    TempoOutputs(downbeat, size);
+
+    // Decaying state stays out of the subnormals even without flush-to-zero
+    for (size_t ch = 0; ch < 2; ch++) {
+        heads_[ch].Flush();
+        oversamplers[ch].Flush();
+    }
+    shared_.env.Flush();
+    level_ = fixdenorm(level_);
+}
+
+// Once per callback: the delay cycle moves on by `size` samples. The gate
+// fires where it wraps, or where it realigns to the clock (`downbeat`),
+// and the LED reads the phase it ends on. Counted in samples, so a whole
+// number of samples per cycle wraps on exactly the same sample every time.
+void TapeDelayCore::TempoOutputs(int downbeat, size_t size) {
+    const float period = current_delay_ms_ * (sample_rate_ / 1000.0f);
+    const float len = static_cast<float>(size);
+    gate_offset_ = -1;
+    if (downbeat >= 0) {
+        gate_offset_ = downbeat;
+        tempo_pos_ = static_cast<float>(size - 1 - static_cast<size_t>(downbeat));
+    } else {
+        // Sample i ends tempo_pos_ + i + 1 samples into the cycle
+        const float to_wrap = ceilf(period - tempo_pos_) - 1.0f;
+        if (to_wrap < len) gate_offset_ = (to_wrap > 0.0f) ? static_cast<int>(to_wrap) : 0;
+        tempo_pos_ += len;
+        while (tempo_pos_ >= period) tempo_pos_ -= period;
+    }
+    led_phase_ = tempo_pos_ / period;
+
+    // Peak hold with a ~150 ms fall
+    if (size != level_block_) {
+        level_block_ = size;
+        level_fall_ = expf(-len / (0.15f * sample_rate_));
+    }
+    level_ = (level_peak_ > level_) ? level_peak_ : level_ * level_fall_;
+    level_peak_ = 0.0f;
+}
+
+} // namespace tape
@@ -0,0 +1,364 @@
+/**
+ * TapeDelay DSP core
+ *
+ * Everything that turns control values and audio into audio, with no reference
+ * to the Patch SM: the firmware (TapeDelay.cpp) reads the panel into a
+ * ControlFrame once per callback and hands it over together with the audio
+ * buffers; the host tools (host/) do the same from a mock control layer.
+ *
+ * The tape is owned by the caller so the firmware can place it in SDRAM.
+ * Both channels share one interleaved tape (StereoTape) and one read
+ * position; the right channel is written STEREO_OFFSET frames ahead so it
+ * plays back that much later from the same cache lines.
+ */
+
+#pragma once
+
+#include "TapeClock.h"
+#include "TapeDsp.h"
+#include "TapeFlutter.h"
+#include "TapeProfiler.h"
+#include "TapeOversample.h"
+#include "TapeParams.h"
+#include "TapePrefetch.h"
+#include "TapeSat.h"
+#include "TapeTrap.h"
+
+namespace tape {
+
+// Configuration
+#define MAX_DELAY_TIME_SEC 3.0f
+#define MAX_DELAY static_cast<size_t>(48000 * MAX_DELAY_TIME_SEC)
+// Largest block the core processes in one go; longer callbacks are split
+#define MAX_BLOCK_SIZE static_cast<size_t>(256)
+// gen~ 'character' for the saturation envelope; there is no knob for it here
+#define SAT_CHARACTER 0.25f
+// Right channel delay over the left, in samples
+#define STEREO_OFFSET static_cast<size_t>(50)
+// gen~ `hysterisis`: the feeder expansion's release
+#define FEEDER_DECAY 0.0002f
+// Time constant of the tape's glide to a new delay time, in ms
+#define DELAY_GLIDE_MS 41.7f
+// Knob movement below this counts as ADC noise (about 1/500 of the travel)
+#define KNOB_HYSTERESIS 0.002f
+// Tape sample format: 0 float, 1 int16 (half the tape memory and SDRAM
+// traffic, ~-96 dB noise floor). Set from the Makefiles: TAPE16=1.
+#ifndef TAPE_SAMPLE_INT16
+#define TAPE_SAMPLE_INT16 0
+#endif
+
+#if TAPE_SAMPLE_INT16
+using TapeLine = StereoTape<MAX_DELAY, int16_t>;
+#else
+using TapeLine = StereoTape<MAX_DELAY, float>;
+#endif
+
+// State both channels' heads work from, owned by TapeDelayCore
+struct HeadShared {
+    // Trap filter coefficients (see TapeTrap.h); 201's lowpass follows the
+    // Filter knob
+    TrapDesign trap;
+    SatTable sat;
+    CpuProfiler prof;
+
+    // Saturation quality (see Quality) and, for quality 1 and 2, the
+    // per-sample gains of the current block from SatEnvelope
+    int quality = QUALITY_LUT_COSINE;
+    SatEnvelope env;
+    float satPre[MAX_BLOCK_SIZE];
+    float satPost[MAX_BLOCK_SIZE];
+    float satMod[MAX_BLOCK_SIZE];
+
+    // Oversampling factor of the saturator (1, 2 or 4) and the delay its
+    // filters add, which the tape read takes off again
+    int os_factor = 1;
+    float os_latency = 0.0f;
+};
+
+// One channel of the tape loop: everything after the tape read up to the
+// write of the next pass. The read itself is done by the core for both
+// channels at once.
+struct TapeHead {
+    TapeLine *tape;
+    size_t lane;       // 0 left, 1 right
+    size_t skew;       // frames this lane is written ahead (STEREO_OFFSET on the right)
+    TrapFilter trap;                     // output filters, per topology
+    OnePole6dB fbLpFilter, fbHpFilter;   // feedback path while reversed (201)
+    FeederExpander feeder;               // forward path only (gen~ feederCompression)
+    HeadShared *shared;
+    Oversampler *os;   // in DTCM, see TapeDelayCore::Init()
+    float dc_x = 0.0f, dc_y = 0.0f;
+
+    float next_feedback_signal = 0.0f;
+
+    // Per-block parameters for ProcessBlock()
+    Ramp fb_gain;
+    float sat_mod_offset = 0.0f;   // added to the envelope modifier (gen~ `S` on the right)
+
+    void Init(float sr, TapeLine *line, size_t lane_index, size_t lane_skew,
+              HeadShared *shared_state);
+
+    // Process n <= MAX_BLOCK_SIZE samples with the parameters above held for the
+    // block, when every read of the block lands on tape written before the
+    // block started. `wet` holds this lane's tape read on entry and the wet
+    // output on return; each stage runs as its own loop over the block.
+    // In reverse, `rev` is this lane's reverse head read: it becomes the
+    // output, and the forward read only feeds back (gen~ routing).
+    void ProcessBlock(const float *in, float *wet, const float *rev, size_t n);
+
+    // Same, for delays shorter than the block: reads, writes and feedback
+    // alternate one sample at a time. `read` is the read position of each
+    // sample relative to the write pointer at the start of the block, and
+    // `interp` the Interp the block's tape reads use (not INTERP_AUTO).
+    void ProcessSamples(const float *in, const float *read, const float *rev, float *out, size_t n,
+                        int interp);
+
+    // Just the output stage (trap filters, DC block, soft limit) from `src` into
+    // `wet`, with no tape write: the hold loop while it fades in. `gain`, if
+    // given, scales the filtered signal ahead of the DC block (the feeder
+    // expansion).
+    void Filter(const float *src, float *wet, size_t n, const float *gain = nullptr);
+
+    // fixdenorm on every recursive state and on the feedback (gen~ fixes
+    // fbL / fbR), once per callback
+    void Flush();
+
+    // Either way the saturation runs as a kernel compiled for the active
+    // quality, and the filters as one for the active topology, chosen once
+    // per block. The core advances the tape after both
+    // channels have written their block.
+
+  private:
+    // Tape drive for sample i of the block, specialised per quality (and per
+    // curve at quality 2, where the table is not used)
+    template <int Q, int NL>
+    inline float Saturate(float x, size_t i, DcBlock &dc) const;
+    // Saturate() at OS times the sample rate
+    template <int Q, int NL, int OS>
+    inline float Drive(float x, size_t i, DcBlock &dc);
+
+    template <int Q, int NL, int T, typename I>
+    float ProcessSample(float in, float feedback_signal, float read_pos, const float *rev, size_t i);
+    template <int Q, int NL, int T, typename I>
+    void SampleKernel(const float *in, const float *read, const float *rev, float *out, size_t n);
+    template <int Q, int NL, int OS>
+    void WriteKernel(const float *in, const float *fb_src, size_t n);
+
+    DcBlock sat_dc_;   // quality 2 only
+
+    // Scratch for the block stages
+    float feedback_[MAX_BLOCK_SIZE];
+    float write_[MAX_BLOCK_SIZE];
+    float feed_[MAX_BLOCK_SIZE];
+};
+
+// Raw panel state for one audio callback. Knob values are the knob + CV sums
+// exactly as read from the ADCs (unclamped); the booleans are edges that
+// happened since the previous callback.
+struct ControlFrame {
+    float time = 0.0f;      // ADC_9  + CV_1
+    float feedback = 0.0f;  // CV_7   + CV_2
+    float mix = 0.0f;       // CV_8   + CV_3
+    float tone = 0.0f;      // ADC_10 + CV_4
+    float flutter = 0.0f;   // ADC_11 + CV_5
+
+    bool clock_trig = false;       // Gate In 1 rising edge
+    size_t clock_offset = 0;       // ...on this sample of the block
+    bool freeze_pressed = false;   // D1 rising edge
+    bool reverse_pressed = false;  // D2 rising edge
+};
+
+// Reverse head motion (gen~ `reversestyle`). Either way the head runs
+// backwards from just behind the write head, twice as fast relative to it,
+// and is faded in and out at its loop edges.
+enum ReverseStyle {
+    REVERSE_SWEEP,   // 0: sweeps the whole tape, whatever the delay time
+    REVERSE_LOOP,    // 1: plays the last delay period backwards, one loop per period (default)
+    REVERSE_STYLE_COUNT,
+};
+
+// Tape head modes: the gen~ Mode selector (1..12). Head 1 reads at the
+// delay time, heads 2 and 3 one and two delay times further back; each mode
+// plays some of them, swapped and summed per side. Mode 5 is mode 1 (gen~
+// adds its reverb there) and mode 12 mutes the heads (reverb only in gen~).
+#define HEAD_MODE_COUNT 12
+
+// Tape head interpolation (policies in TapeDsp.h). Auto picks one per block:
+// none while the delay stands on a whole sample (to 1/1000), so a static
+// echo reads one tap instead of four; linear while the delay slews more than
+// INTERP_FAST_SLEW samples per sample off tape speed; Hermite under flutter
+// and slow glides; and cosine for the reverse heads, as gen~ does. The
+// others put one interpolator on every head.
+enum Interp {
+    INTERP_AUTO,      // 0 (default)
+    INTERP_NONE,      // 1: nearest whole sample
+    INTERP_LINEAR,    // 2
+    INTERP_COSINE,    // 3: gen~ interp="cosine"
+    INTERP_CUBIC,     // 4: gen~ interp="cubic"
+    INTERP_HERMITE,   // 5: every read as before the policies
+    INTERP_COUNT,
+};
+#define INTERP_FAST_SLEW 0.25f
+
+class TapeDelayCore {
+  public:
+    void Init(float sample_rate, TapeLine *tape);
+
+    // Process one audio block. `in` / `out` are the usual non-interleaved
+    // [channel][sample] buffers, two channels.
+    void Process(const ControlFrame &ctl, const float *const *in, float **out, size_t size);
+
+    // Tempo outputs of the last callback: the sample a gate pulse starts on
+    // (or -1), where the delay cycle ended up (0..1, 0 on the beat), and
+    // the output's peak level with a short fall.
+    int GateOffset() const { return gate_offset_; }
+    float LedPhase() const { return led_phase_; }
+    float Level() const { return level_; }
+    bool Frozen() const { return freeze_mode_; }
+    bool Reversed() const { return reverse_mode_; }
+
+    // Callers bracket each callback with Profiler().BeginCallback() /
+    // EndCallback() so that panel reading is included in the measurement.
+    CpuProfiler &Profiler() { return shared_.prof; }
+
+    // Saturation curve (see Nonlin). Rebuilds the lookup table, so call it
+    // from the main loop, not the audio callback.
+    void SetNonlin(int nonlin) { shared_.sat.Select(nonlin); }
+    int GetNonlin() const { return shared_.sat.Nonlin(); }
+
+    // Saturation quality (see Quality); takes effect from the next block
+    void SetQuality(int quality);
+    int GetQuality() const { return shared_.quality; }
+
+    // Oversampling of the saturator: 1, 2 or 4 (anything else is 1). Takes
+    // effect at the start of the next callback, which also clears the
+    // oversampling filters.
+    void SetOversampling(int factor);
+    int GetOversampling() const { return os_request_; }
+
+    // Stage each block's tape reads through DTCM (see TapePrefetch.h).
+    // Output is identical either way; on by default.
+    void SetReadPrefetch(bool on) { prefetch_on_ = on; }
+    bool GetReadPrefetch() const { return prefetch_on_; }
+
+    // Trap filter topology (see Topology); takes effect at the start of the
+    // next callback, which also clears the new topology's filters
+    void SetTopology(int topology);
+    int GetTopology() const { return topology_request_; }
+
+    // Head mode 1..12 (see HEAD_MODE_COUNT); takes effect from the next block
+    void SetHeadMode(int mode);
+    int GetHeadMode() const { return head_mode_; }
+
+    // Reverse head motion (see ReverseStyle); takes effect at its next loop
+    void SetReverseStyle(int style);
+    int GetReverseStyle() const { return reverse_style_; }
+
+    // Glide to a new delay time: its time constant in ms (0 jumps)
+    void SetDelayGlide(float ms) { delayGlide_.SetTime(ms); }
+    float GetDelayGlide() const { return delayGlide_.Time(); }
+
+    // Tape head interpolation (see Interp); takes effect from the next block
+    void SetInterp(int interp);
+    int GetInterp() const { return interp_; }
+
+  private:
+    void ProcessControls(const ControlFrame &ctl);
+    // Gate, LED phase and level at the end of a callback
+    void TempoOutputs(int downbeat, size_t size);
+    // Positions, loop lengths and fades of the reverse head for a block;
+    // `wobble` is the flutter's, or null with the flutter at rest
+    void ReverseMotion(float target_delay, const float *wobble, size_t n);
+    // Positions and edge fades of the hold loop for a block; `running` when
+    // the tape moves on under it (the loop fading out after a release)
+    void HoldMotion(size_t n, bool running);
+    // Reads the heads mode M plays, through interpolator I, and mixes them
+    // into l / r. Head 1 reads at pos[i] (through `window` if set), its right
+    // lane at posR[i] if set; heads 2 and 3 one and two hop[i] further back.
+    // `gain` (reverse and hold fades) scales the result if set.
+    template <int M, typename I>
+    void ReadHeads(const TapeWindow<TapeLine::Sample> *window, const float *pos, const float *posR,
+                   const float *hop, const float *gain, float *l, float *r, size_t n);
+
+    TapeLine *tape_ = nullptr;
+    TapeHead heads_[2];
+    HeadShared shared_;
+    FlutterMod flutter_;
+    float sample_rate_ = 48000.0f;
+
+    // Sync & LED & Gate Out
+    ClockTracker clock_;
+    ClockRatio clock_ratio_ = {1, 1};   // what the Time knob asks for when synced
+    float current_delay_ms_ = 500.0f;
+    float tempo_pos_ = 0.0f;   // samples into the delay cycle
+    float led_phase_ = 0.0f;
+    int gate_offset_ = -1;
+    float level_ = 0.0f, level_peak_ = 0.0f;
+    float level_fall_ = 1.0f;  // level_ decay per callback of level_block_ samples
+    size_t level_block_ = 0;
+
+    bool reverse_mode_ = false;
+    bool freeze_mode_ = false;
+
+    volatile int os_request_ = 1;
+    volatile int topology_request_ = TOPOLOGY_201;
+
+    ReadPrefetch prefetch_;
+    bool prefetch_on_ = true;
+
+    // Left channel delay in samples, gliding to the target once per block
+    // (the flutter is added on top)
+    Glide delayGlide_;
+
+    // Knobs after the jitter filter, what is derived from them (only
+    // recomputed when they move), and the parameters that glide per sample:
+    // feedback and mix as gen~ fbamp (cpsm), flutter depth as gen~ wctrl
+    // (smpsmooth). The first callback jumps straight to the knobs.
+    Hysteresis knobTime_, knobFeedback_, knobMix_, knobTone_, knobFlutter_;
+    float knob_delay_ms_ = 500.0f;
+    float fb_target_ = 0.0f, mix_target_ = 0.0f, flutter_target_ = 0.0f;
+    Smoother<Cpsm> fbSmooth_, mixSmooth_;
+    Smoother<SmpSmooth> flutterSmooth_;
+    bool params_primed_ = false;
+
+    int interp_ = INTERP_AUTO;
+
+    // Reverse head: samples into the current loop, loop length, and the
+    // head's distance behind the write head at the loop start
+    int head_mode_ = 1;
+    int reverse_style_ = REVERSE_LOOP;
+    float rev_phase_ = 0.0f;
+    float rev_length_ = 0.0f;
+    float rev_start_ = 0.0f;
+
+    // Hold (D1): the tape stops and one head loops the last delay period.
+    // gen~ holdsmooth (0 playing .. 1 held), kept as its distance from
+    // where it is heading so that it gets there in float precision; where
+    // the loop starts, behind the stopped write pointer; its length and
+    // phase; the floor and ramp of its edge fades (gen~ multrap); how far
+    // the tape has moved on since (while the loop fades out after a
+    // release); and whether the loop is in its first pass, which needs no
+    // fade in.
+    float hold_dist_ = 0.0f;
+    float hold_top_ = 0.0f;
+    float hold_length_ = 1.0f;
+    float hold_phase_ = 0.0f;
+    float hold_lo_ = 0.0f;
+    float hold_ramp_ = 0.05f;
+    float hold_behind_ = 0.0f;
+    bool hold_first_ = false;
+
+    // Per-block flutter wobble, read positions (and head spacing) and wet outputs
+    float wobble_[MAX_BLOCK_SIZE];
+    float read_[MAX_BLOCK_SIZE], readR_[MAX_BLOCK_SIZE], hop_[MAX_BLOCK_SIZE];
+    float revRead_[MAX_BLOCK_SIZE], revHop_[MAX_BLOCK_SIZE], revGain_[MAX_BLOCK_SIZE];
+    float wetL_[MAX_BLOCK_SIZE], wetR_[MAX_BLOCK_SIZE];
+    float revL_[MAX_BLOCK_SIZE], revR_[MAX_BLOCK_SIZE];
+    float holdRead_[MAX_BLOCK_SIZE], holdGain_[MAX_BLOCK_SIZE], holdMix_[MAX_BLOCK_SIZE];
+    float holdL_[MAX_BLOCK_SIZE], holdR_[MAX_BLOCK_SIZE];
+    float dryL_[MAX_BLOCK_SIZE], dryR_[MAX_BLOCK_SIZE];
+};
+
+float MapLog(float input, float min_freq, float max_freq);
+
+} // namespace tape
@@ -1,352 +1,380 @@
 /**
  * Gen~ Modeled Tape Delay for Electro-Smith Daisy Patch Submodule
- * WITH FREEZE/BLUR (D1, stable), REVERSE FEEDBACK (D2), CLOCK SYNC (Gate In 1), LED, AND GATE OUT 2 TEMPO
+ * WITH FREEZE/BLUR (D1, stable), REVERSE (D2), CLOCK SYNC (Gate In 1), LED, AND GATE OUT 2 TEMPO
  * * HARDWARE CONNECTIONS:
  * ---------------------
  * Knobs:
- * 1. Time     -> ADC 9  (Delay Time / Clock Divider if synced)
+ * 1. Time     -> ADC 9  (Delay Time / Clock Ratio if synced)
  * 2. Feedback -> CV 7   (Intensity)
  * 3. Mix      -> CV 8   (Dry/Wet)
  * 4. Filter   -> ADC 10 (Tone)
  * 5. Flutter  -> ADC 11 (Wow/Flutter Amount)
  * * Inputs:
- * - Gate In 1 -> CLOCK INPUT (Syncs delay time)
+ * - Gate In 1 -> CLOCK INPUT (Syncs delay time; edges timestamped to the sample)
  * - Audio In  -> L/R
  * * Controls:
  * - Button D1 -> FREEZE/BLUR TOGGLE (Stops input, sets feedback to infinite, now stable)
- * - Button D2 -> REVERSE FEEDBACK TOGGLE
+ * - Button D2 -> REVERSE TOGGLE
+ * - D1 / D2 / both held at power-up -> alternative audio block sizes (see TAPE_BLOCK_SIZE)
  * * Outputs:
- * - Gate Out 2 -> TEMPO CLOCK OUTPUT
+ * - Gate Out 2 -> TEMPO CLOCK OUTPUT (timer-driven, on the beat's sample)
  * - Audio Out -> L/R
  * * Indicator:
- * - LED (B8)  -> Blinks at tempo, solid when Freeze or Reverse is active
+ * - LED (B8)  -> PWM: flashes at tempo, glows with the output level, solid when Freeze or Reverse is active
  */
 
 #include "daisy_patch_sm.h"
-#include "daisysp.h"
-#include <cmath>
+#include "stm32h7xx_hal.h"
+#include "TapeCore.h"
 
 using namespace daisy;
 using namespace patch_sm;
-using namespace daisysp;
 
 DaisyPatchSM patch;
 
 // Configuration
-#define MAX_DELAY_TIME_SEC 3.0f 
-#define MAX_DELAY static_cast<size_t>(48000 * MAX_DELAY_TIME_SEC)
-// 1 second of audio for the reverse loop
-#define REVERSE_BUFFER_SIZE static_cast<size_t>(48000) 
+// Tape saturation curve: 0 tanh, 1 polynomial, 2 cubic, 3 parabolic (see TapeSat.h)
+#define TAPE_NONLIN 0
+// Saturation quality: 0 table/cosine, 1 table/cubic + envelope, 2 realtime + envelope
+#define TAPE_QUALITY 0
+// Saturator oversampling: 1, 2 or 4 (see `tape_bench quality` for the cost)
+#define TAPE_OVERSAMPLE 1
+// Stage tape reads through DTCM with the MDMA: 1 on, 0 read SDRAM in place
+#define TAPE_READ_PREFETCH 1
+// Tape heads: gen~ Mode 1..12 (1 single head, 2..11 heads at 2x / 3x the delay)
+#define TAPE_HEAD_MODE 1
+// Trap filters: 0 '201', 1 LoFi, 2 Old, 3 Dark (see TapeTrap.h)
+#define TAPE_TOPOLOGY 0
+// Reverse heads: 0 sweep the whole tape, 1 loop over the delay time (see TapeCore.h)
+#define TAPE_REVERSE_STYLE 1
+// Tape head interpolation: 0 auto, 1 none, 2 linear, 3 cosine, 4 cubic, 5 Hermite (see TapeCore.h)
+#define TAPE_INTERP 0
+// Gate Out 2 tempo pulse width
+#define TAPE_GATE_WIDTH_MS 10
+// LED glow at full output level, as a fraction of full brightness
+#define TAPE_LED_GLOW 0.3f
+// Audio block size (1..256 samples), and the ones picked by holding D1, D2
+// or both at power-up. The added latency is two blocks (in, then out).
+#define TAPE_BLOCK_SIZE 48
+#define TAPE_BLOCK_SIZE_D1 8
+#define TAPE_BLOCK_SIZE_D2 256
+#define TAPE_BLOCK_SIZE_BOTH 1
+// Panel reads per second, whatever the block size
+#define TAPE_CONTROL_RATE 1000
 
 // Buffers
-DelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delMems[2];
-float DSY_SDRAM_BSS reverseBufferL[REVERSE_BUFFER_SIZE];
-float DSY_SDRAM_BSS reverseBufferR[REVERSE_BUFFER_SIZE];
+tape::TapeLine DSY_SDRAM_BSS tapeMem;   // L/R interleaved
 
-// Globals for Sync & LED & Gate Out
-GPIO led;
+// Globals for Buttons
 Switch mode_button;      // D2 for reverse mode
-Switch freeze_button;    // D1 for freeze/blur mode
-uint32_t last_clock_tick = 0;
-float current_delay_ms = 500.0f;
-bool is_clocked = false;
-float led_phase = 0.0f; 
-bool reverse_feedback_mode = false;
-bool freeze_mode = false;
+Switch freeze_button;    // D1 for hold
+
+tape::TapeDelayCore core;
 
 // --------------------------------------------------------------------------
-// DSP FUNCTIONS (Ported from gen~)
+// CLOCK INPUT
 // --------------------------------------------------------------------------
+// Gate In 1 (B10) edges are stamped with the cycle counter from its EXTI
+// interrupt, so the core gets them to the sample instead of to the
+// callback. The jack is inverted: a rising gate pulls the pin low.
+static_assert(DaisyPatchSM::B10.pin >= 10 && DaisyPatchSM::B10.pin <= 15, "Gate In 1 is on EXTI15_10");
+
+volatile uint32_t clock_edge_cycles = 0;
+volatile bool clock_edge = false;
+uint32_t cycles_per_sample = 10000;
+
+extern "C" void EXTI15_10_IRQHandler() {
+    const uint16_t mask = static_cast<uint16_t>(1u << DaisyPatchSM::B10.pin);
+    if (__HAL_GPIO_EXTI_GET_IT(mask)) {
+        __HAL_GPIO_EXTI_CLEAR_IT(mask);
+        clock_edge_cycles = tape::CycleCount();
+        clock_edge = true;
+    }
+}
 
-float tnhLam(float x) {
-    float x2 = x * x;
-    float a = (((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f) * x;
-    float b = ((28.0f * x2 + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
-    return fclamp(a / b, -1.0f, 1.0f);
+void InitClockInput() {
+    tape::EnableCycleCounter();
+    cycles_per_sample = System::GetSysClkFreq() / static_cast<uint32_t>(patch.AudioSampleRate());
+
+    // Same pin libDaisy reads gate_in_1 from, now also raising the interrupt
+    const Pin pin = DaisyPatchSM::B10;
+    GPIO_InitTypeDef init = {};
+    init.Pin = 1u << pin.pin;
+    init.Mode = GPIO_MODE_IT_FALLING;
+    init.Pull = GPIO_NOPULL;
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    HAL_GPIO_Init(reinterpret_cast<GPIO_TypeDef *>(GPIOA_BASE + 0x400u * static_cast<uint32_t>(pin.port)), &init);
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 }
 
-float softStatic(float x) {
-    if (x > 1.0f) return (1.0f - 4.0f / (x + 3.0f)) * 4.0f + 1.0f;
-    else if (x < -1.0f) return (1.0f + 4.0f / (x - 3.0f)) * -4.0f - 1.0f;
-    else return x;
+// The block in `in` was recorded over the `size` samples before the
+// callback started at `now`, so an edge `ago` cycles earlier is on sample
+// size - 1 - ago / cycles_per_sample of it. An edge after `now` waits for
+// the next block.
+void ReadClockEdge(uint32_t now, size_t size, tape::ControlFrame &ctl) {
+    if (!clock_edge) return;
+    const int32_t ago = static_cast<int32_t>(now - clock_edge_cycles);
+    if (ago < 0) return;
+    clock_edge = false;
+    const uint32_t back = static_cast<uint32_t>(ago) / cycles_per_sample;
+    ctl.clock_trig = true;
+    ctl.clock_offset = (back < size) ? size - 1 - back : 0;
 }
 
-struct OnePole6dB {
-    float y0 = 0.0f;
-    float sample_rate;
-    void Init(float sr) { sample_rate = sr; }
-    float Process(float x, float cutoff, int type) {
-        float f = fclamp(sinf(cutoff * TWOPI_F / sample_rate), 0.00001f, 0.99999f);
-        float lp = y0 + f * (x - y0);
-        y0 = lp;
-        return (type == 1) ? lp - x : lp;
+// --------------------------------------------------------------------------
+// GATE OUT AND LED
+// --------------------------------------------------------------------------
+// Gate Out 2 (B6, PC13) has no timer channel, so TIM16 counts samples in
+// one-pulse mode and its interrupts drive the pin: compare 1 raises the
+// gate on the beat's sample, the update at the end of the pulse drops it.
+// The LED (B8, PB9) is TIM17 channel 1 in PWM.
+TIM_HandleTypeDef gate_timer;
+TIM_HandleTypeDef led_timer;
+uint32_t gate_width = 1;    // samples
+
+extern "C" void TIM16_IRQHandler() {
+    if (__HAL_TIM_GET_FLAG(&gate_timer, TIM_FLAG_CC1)) {
+        __HAL_TIM_CLEAR_FLAG(&gate_timer, TIM_FLAG_CC1);
+        dsy_gpio_write(&patch.gate_out_2, 1);
     }
-};
-
-struct TapeHead {
-    DelayLine<float, MAX_DELAY> *del;
-    OnePole6dB lpFilter, hpFilter;
-    float currentDelay = 24000.0f;
-    float dc_x = 0.0f, dc_y = 0.0f;
-    
-    // Reverse Buffer state
-    float *rev_buffer;
-    size_t write_idx = 0;
-    size_t rev_read_idx = 0;
-    bool recording_done = false;
-    
-    float next_feedback_signal = 0.0f; 
-
-    void Init(float sr, float *buffer_ptr) { 
-        lpFilter.Init(sr); 
-        hpFilter.Init(sr); 
-        rev_buffer = buffer_ptr;
-        rev_read_idx = REVERSE_BUFFER_SIZE - 1; 
+    if (__HAL_TIM_GET_FLAG(&gate_timer, TIM_FLAG_UPDATE)) {
+        __HAL_TIM_CLEAR_FLAG(&gate_timer, TIM_FLAG_UPDATE);
+        dsy_gpio_write(&patch.gate_out_2, 0);
     }
+}
 
-    float Process(float in, float feedback_signal, float delay_samps, float tone_freq, bool reverse_fb_active) {
-        
-        // --- GAIN STABILITY FIX ---
-        // Corrective attenuation factor applied only when in freeze mode 
-        float corrected_fb_signal = feedback_signal;
-        // Check global flag, not the function argument `reverse_fb_active`
-        if (freeze_mode) { 
-            // 0.768f results in an overall loop gain of ~0.9984 (safe) to prevent blowup.
-            corrected_fb_signal *= 0.85f; 
-        }
-
-        // 1. Process main delay
-        float fb_input_for_write = corrected_fb_signal; 
-        float saturated_signal = tnhLam((in + fb_input_for_write) * 1.3f);
-        del->Write(saturated_signal);
-        fonepole(currentDelay, delay_samps, 0.0005f); 
-        float tape_out = del->ReadHermite(currentDelay);
-
-        // 2. Filters (201 Topology)
-        float lp_out = lpFilter.Process(tape_out, tone_freq, 0); 
-        float hp_out = hpFilter.Process(lp_out, 147.0f, 1);
-        
-        // 3. DC Block & Soft Limit -> WET OUTPUT
-        float clean_delayed_signal = hp_out - dc_x + 0.995f * dc_y;
-        dc_x = hp_out; dc_y = clean_delayed_signal;
-        clean_delayed_signal = softStatic(clean_delayed_signal);
-
-
-        // --- REVERSE FEEDBACK MECHANISM ---
-        next_feedback_signal = clean_delayed_signal; // Default feedback source 
-        
-        if (reverse_fb_active) {
-            // A. Always record the current delayed/filtered signal (WET OUTPUT) into the buffer
-            rev_buffer[write_idx] = clean_delayed_signal;
-            
-            // B. Check for full buffer (first time only)
-            if (!recording_done && write_idx == REVERSE_BUFFER_SIZE - 1) {
-                recording_done = true;
-            }
-
-            if (recording_done) {
-                // C. Read backward for next feedback cycle
-                next_feedback_signal = rev_buffer[rev_read_idx]; 
-
-                // D. Decrement read index, wrapping from 0 back to N-1
-                if (rev_read_idx == 0) {
-                    rev_read_idx = REVERSE_BUFFER_SIZE - 1;
-                } else {
-                    rev_read_idx--;
-                }
-            } else {
-                 // Use silence until the buffer is full to prevent initial glitches
-                 next_feedback_signal = 0.0f;
-            }
-        }
-        
-        // 4. Increment write index 
-        write_idx = (write_idx + 1) % REVERSE_BUFFER_SIZE;
-        
-        // Return the WET OUTPUT
-        return clean_delayed_signal;
-    }
-};
+void InitTempoOutputs() {
+    // APB2 timers run at twice PCLK2
+    const uint32_t timer_clock = 2 * HAL_RCC_GetPCLK2Freq();
+    const uint32_t sr = static_cast<uint32_t>(patch.AudioSampleRate());
+    gate_width = TAPE_GATE_WIDTH_MS * sr / 1000;
+    if (gate_width < 1) gate_width = 1;
+
+    // One tick per sample
+    __HAL_RCC_TIM16_CLK_ENABLE();
+    gate_timer.Instance = TIM16;
+    gate_timer.Init.Prescaler = timer_clock / sr - 1;
+    gate_timer.Init.CounterMode = TIM_COUNTERMODE_UP;
+    gate_timer.Init.Period = 0xffff;
+    gate_timer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    gate_timer.Init.RepetitionCounter = 0;
+    gate_timer.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    HAL_TIM_Base_Init(&gate_timer);
+    gate_timer.Instance->CR1 |= TIM_CR1_OPM;
+    __HAL_TIM_CLEAR_FLAG(&gate_timer, TIM_FLAG_CC1 | TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_IT(&gate_timer, TIM_IT_CC1 | TIM_IT_UPDATE);
+    HAL_NVIC_SetPriority(TIM16_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM16_IRQn);
+
+    // LED PWM at 20 kHz
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_TIM17_CLK_ENABLE();
+    const Pin pin = DaisyPatchSM::B8;
+    GPIO_InitTypeDef init = {};
+    init.Pin = 1u << pin.pin;
+    init.Mode = GPIO_MODE_AF_PP;
+    init.Pull = GPIO_NOPULL;
+    init.Speed = GPIO_SPEED_FREQ_LOW;
+    init.Alternate = GPIO_AF1_TIM17;
+    HAL_GPIO_Init(reinterpret_cast<GPIO_TypeDef *>(GPIOA_BASE + 0x400u * static_cast<uint32_t>(pin.port)), &init);
+
+    led_timer.Instance = TIM17;
+    led_timer.Init.Prescaler = 0;
+    led_timer.Init.CounterMode = TIM_COUNTERMODE_UP;
+    led_timer.Init.Period = timer_clock / 20000 - 1;
+    led_timer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    led_timer.Init.RepetitionCounter = 0;
+    led_timer.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    HAL_TIM_PWM_Init(&led_timer);
+    TIM_OC_InitTypeDef oc = {};
+    oc.OCMode = TIM_OCMODE_PWM1;
+    oc.Pulse = 0;
+    oc.OCPolarity = TIM_OCPOLARITY_HIGH;
+    oc.OCFastMode = TIM_OCFAST_DISABLE;
+    HAL_TIM_PWM_ConfigChannel(&led_timer, &oc, TIM_CHANNEL_1);
+    HAL_TIM_PWM_Start(&led_timer, TIM_CHANNEL_1);
+}
 
-TapeHead heads[2];
-Oscillator flutterLfo, flutterLfo2;
-float sample_rate;
+// The block being written plays out after the one being read in, so its
+// sample `offset` leaves the codec size + offset samples after the callback
+// started at `now`. A pulse still high from the last beat is cut short.
+void ScheduleGate(int offset, uint32_t now, size_t size) {
+    __HAL_TIM_DISABLE(&gate_timer);
+    dsy_gpio_write(&patch.gate_out_2, 0);
+
+    const int32_t elapsed = static_cast<int32_t>((tape::CycleCount() - now) / cycles_per_sample);
+    int32_t wait = static_cast<int32_t>(size) + offset - elapsed;
+    if (wait < 1) wait = 1;
+    __HAL_TIM_SET_COUNTER(&gate_timer, 0);
+    __HAL_TIM_SET_COMPARE(&gate_timer, TIM_CHANNEL_1, static_cast<uint32_t>(wait));
+    __HAL_TIM_SET_AUTORELOAD(&gate_timer, static_cast<uint32_t>(wait) + gate_width);
+    __HAL_TIM_CLEAR_FLAG(&gate_timer, TIM_FLAG_CC1 | TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE(&gate_timer);
+}
 
-float MapLog(float input, float min_freq, float max_freq) {
-    input = fclamp(input, 0.0f, 1.0f);
-    return min_freq * powf(max_freq / min_freq, input);
+// Full on for the first 10% of the delay cycle and while Reverse or Freeze
+// is active, otherwise a glow that follows the output level
+void WriteLed() {
+    float duty = core.Level() * TAPE_LED_GLOW;
+    if (duty > TAPE_LED_GLOW) duty = TAPE_LED_GLOW;
+    if (core.LedPhase() < 0.1f || core.Reversed() || core.Frozen()) duty = 1.0f;
+    const uint32_t period = __HAL_TIM_GET_AUTORELOAD(&led_timer) + 1;
+    __HAL_TIM_SET_COMPARE(&led_timer, TIM_CHANNEL_1, static_cast<uint32_t>(duty * static_cast<float>(period)));
 }
 
 // --------------------------------------------------------------------------
 // CONTROL PROCESSING
 // --------------------------------------------------------------------------
-void ProcessControls() {
-    patch.ProcessAnalogControls();
-    
-    // Process the Reverse Mode Button (D2)
-    mode_button.Debounce();
-    if (mode_button.RisingEdge()) {
-        reverse_feedback_mode = !reverse_feedback_mode;
-        // If reverse is engaged, ensure freeze is off
-        if (reverse_feedback_mode) {
-             freeze_mode = false;
-        }
-        // Reset reverse buffer state
-        heads[0].recording_done = false;
-        heads[1].recording_done = false;
+// The panel is read every `control_every` callbacks, about TAPE_CONTROL_RATE
+// times a second, so small blocks do not pay for the ADC and the debouncing
+// on every callback. In between the knobs keep their last reading; main()
+// sets the knobs' one-pole smoothing to the panel rate so it keeps its time
+// constant.
+size_t control_every = 1;
+size_t control_wait = 0;
+tape::ControlFrame panel;
+
+void ProcessControls(tape::ControlFrame &ctl) {
+    if (control_wait == 0) {
+        control_wait = control_every;
+        patch.ProcessAnalogControls();
+
+        mode_button.Debounce();
+        freeze_button.Debounce();
+
+        panel.time     = patch.GetAdcValue(ADC_9)  + patch.GetAdcValue(CV_1);
+        panel.feedback = patch.GetAdcValue(CV_7)   + patch.GetAdcValue(CV_2);
+        panel.mix      = patch.GetAdcValue(CV_8)   + patch.GetAdcValue(CV_3);
+        panel.tone     = patch.GetAdcValue(ADC_10) + patch.GetAdcValue(CV_4);
+        panel.flutter  = patch.GetAdcValue(ADC_11) + patch.GetAdcValue(CV_5);
+
+        ctl.freeze_pressed  = freeze_button.RisingEdge();
+        ctl.reverse_pressed = mode_button.RisingEdge();
     }
-    
-    // Process the Freeze Button (D1)
-    freeze_button.Debounce();
-    if (freeze_button.RisingEdge()) {
-        freeze_mode = !freeze_mode;
-        // If freeze is engaged, ensure reverse is off, and reset recording state
-        if (freeze_mode) {
-             reverse_feedback_mode = false;
-        }
+    control_wait--;
+
+    ctl.time     = panel.time;
+    ctl.feedback = panel.feedback;
+    ctl.mix      = panel.mix;
+    ctl.tone     = panel.tone;
+    ctl.flutter  = panel.flutter;
+}
+
+// Block size for the buttons held at power-up. Waits for them to be let go,
+// so the press does not also toggle Hold or Reverse.
+static_assert(TAPE_BLOCK_SIZE >= 1 && TAPE_BLOCK_SIZE <= 256 && TAPE_BLOCK_SIZE_D1 >= 1 && TAPE_BLOCK_SIZE_D1 <= 256
+                  && TAPE_BLOCK_SIZE_D2 >= 1 && TAPE_BLOCK_SIZE_D2 <= 256 && TAPE_BLOCK_SIZE_BOTH >= 1
+                  && TAPE_BLOCK_SIZE_BOTH <= 256,
+              "block sizes are 1..256 samples");
+
+size_t BootBlockSize() {
+    freeze_button.Init(DaisyPatchSM::D1, 1000.0f);
+    mode_button.Init(DaisyPatchSM::D2, 1000.0f);
+    for (int i = 0; i < 20; i++) {
+        freeze_button.Debounce();
+        mode_button.Debounce();
+        System::Delay(1);
+    }
+    static const size_t sizes[4] = {TAPE_BLOCK_SIZE, TAPE_BLOCK_SIZE_D1, TAPE_BLOCK_SIZE_D2, TAPE_BLOCK_SIZE_BOTH};
+    const size_t size = sizes[(freeze_button.Pressed() ? 1 : 0) | (mode_button.Pressed() ? 2 : 0)];
+    while (freeze_button.Pressed() || mode_button.Pressed()) {
+        freeze_button.Debounce();
+        mode_button.Debounce();
+        System::Delay(1);
     }
+    return size;
 }
 
 
 void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size) {
-    ProcessControls(); 
+    const uint32_t now = tape::CycleCount();
+    // Dying echoes stay off the FPU's subnormal path (see TapePlatform.h)
+    tape::ScopedFlushToZero ftz;
+    core.Profiler().BeginCallback();
 
-    // ----------------------
-    // 1. CLOCK / SYNC LOGIC
-    // ----------------------
-    uint32_t now = System::GetNow();
-    if(patch.gate_in_1.Trig()) {
-        float interval = (float)(now - last_clock_tick);
-        if (interval > 40.0f && interval < 3000.0f) {
-            current_delay_ms = interval;
-            is_clocked = true;
-            led_phase = 0.0f;
-        }
-        last_clock_tick = now;
-    }
-    if (now - last_clock_tick > 3500) {
-        is_clocked = false;
-    }
-
-    // ----------------------
-    // 2. PARAMETER CALCULATIONS
-    // ----------------------
-    
-    float target_delay_samps;
-    float raw_time = fclamp(patch.GetAdcValue(ADC_9) + patch.GetAdcValue(CV_1), 0.0f, 1.0f);
-
-    if (is_clocked) {
-        target_delay_samps = (current_delay_ms / 1000.0f) * sample_rate;
-    } else {
-        float knob_delay_ms = 10.0f + (powf(raw_time, 2.5f) * 1500.0f);
-        // FIX 1: Corrected typo from 'knb_delay_ms' to 'knob_delay_ms'
-        target_delay_samps = (knob_delay_ms / 1000.0f) * sample_rate;
-        current_delay_ms = knob_delay_ms;
-    }
+    tape::ControlFrame ctl;
+    ReadClockEdge(now, size, ctl);
+    ProcessControls(ctl);
 
-    float fb_val = fclamp((patch.GetAdcValue(CV_7) + patch.GetAdcValue(CV_2)) * 1.1f, 0.0f, 1.2f);
-    float tone_freq = MapLog(patch.GetAdcValue(ADC_10) + patch.GetAdcValue(CV_4), 400.0f, 18000.0f);
-    float flutter_depth = fclamp(patch.GetAdcValue(ADC_11) + patch.GetAdcValue(CV_5), 0.0f, 1.0f) * 60.0f;
-    float dry_wet = fclamp(patch.GetAdcValue(CV_8) + patch.GetAdcValue(CV_3), 0.0f, 1.0f);
+    core.Process(ctl, in, out, size);
 
+    if (core.GateOffset() >= 0) ScheduleGate(core.GateOffset(), now, size);
+    WriteLed();
 
-    // --- FREEZE OVERRIDE --- 
-    if (freeze_mode) {
-        // Set feedback to unity gain. The actual stability correction happens inside TapeHead::Process.
-        fb_val = 1.0f; 
-        // 100% wet mix
-        dry_wet = 1.0f;
-    }
+    core.Profiler().EndCallback();
+}
 
-    // ----------------------
-    // 3. AUDIO LOOP
-    // ----------------------
-    static float feedL = 0.0f;
-    static float feedR = 0.0f;
-    static bool gate_out_state = false; 
-
-    for (size_t i = 0; i < size; i++) {
-        // Flutter Modulation
-        float wobble = (flutterLfo.Process() + (flutterLfo2.Process() * 0.5f)) * flutter_depth;
-        
-        float dL = fclamp(target_delay_samps + wobble, 10.0f, (float)MAX_DELAY - 100.0f);
-        float dR = fclamp(target_delay_samps + wobble + 50.0f, 10.0f, (float)MAX_DELAY - 100.0f);
-
-        // --- FREEZE AUDIO INPUT --- 
-        float inputL = in[0][i];
-        float inputR = in[1][i];
-        
-        if (freeze_mode) {
-            // Stop writing new audio input to freeze the loop contents
-            inputL = 0.0f;
-            inputR = 0.0f;
-        }
-
-        // Tape Process. outL/R is the WET OUTPUT.
-        float outL = heads[0].Process(inputL, feedL * fb_val, dL, tone_freq, reverse_feedback_mode);
-        float outR = heads[1].Process(inputR, feedR * fb_val, dR, tone_freq, reverse_feedback_mode);
-
-        // Access the member variable for the feedback signal
-        feedL = heads[0].next_feedback_signal;
-        feedR = heads[1].next_feedback_signal;
-
-
-        out[0][i] = (in[0][i] * (1.0f - dry_wet)) + (outL * dry_wet);
-        out[1][i] = (in[1][i] * (1.0f - dry_wet)) + (outR * dry_wet);
-
-        // 4. LED & GATE PHASE CALCULATION
-        float phase_inc = 1.0f / ( (current_delay_ms/1000.0f) * sample_rate );
-        
-        bool phase_wrapped = (led_phase + phase_inc) >= 1.0f;
-        
-        led_phase += phase_inc;
-        if(led_phase >= 1.0f) led_phase -= 1.0f;
-
-        // GATE OUT LOGIC (Trigger pulse generation)
-        if (phase_wrapped) {
-            gate_out_state = true;
-        } else if (i > (size / 2)) {
-            gate_out_state = false;
-        }
+#ifdef TAPE_PROFILE_LOG
+// Print the CPU load report over USB serial, about once a second
+void LogProfile() {
+    static uint32_t last_log = 0;
+    uint32_t now = System::GetNow();
+    if (now - last_log < 1000) return;
+    last_log = now;
+
+    tape::CpuProfiler::Report r;
+    if (!core.Profiler().Snapshot(r)) return;
+    patch.PrintLine("callback: min %lu mean %lu max %lu p99 %lu peak %lu / budget %lu cycles (load %lu%%, peak %lu%%)",
+                    r.total.min, r.total.mean, r.total.max, r.total.p99, r.peak, r.budget,
+                    (uint32_t)(r.load_mean * 100.0f), (uint32_t)(r.load_peak * 100.0f));
+    if (r.prefetch_fails) patch.PrintLine("prefetch: %lu failed copies read in place", r.prefetch_fails);
+#ifdef TAPE_PROFILE_STAGES
+    for (int s = 0; s < tape::CpuProfiler::STAGE_COUNT; s++) {
+        const tape::CpuProfiler::Stats &st = r.stage[s];
+        patch.PrintLine("  %-10s min %lu mean %lu max %lu p99 %lu",
+                        tape::CpuProfiler::StageName(static_cast<tape::CpuProfiler::Stage>(s)),
+                        st.min, st.mean, st.max, st.p99);
     }
-    
-    // FIX 2: Corrected Gate Out 2 write syntax
-    dsy_gpio_write(&patch.gate_out_2, gate_out_state ? 1 : 0);
+#endif
 }
+#endif
 
 int main(void) {
     patch.Init();
-    sample_rate = patch.AudioSampleRate();
 
-    // Init GPIO
-    led.Init(DaisyPatchSM::B8, GPIO::Mode::OUTPUT);
-    
-    // Init Buttons D1 and D2
-    freeze_button.Init(DaisyPatchSM::D1, patch.AudioCallbackRate()); 
-    mode_button.Init(DaisyPatchSM::D2, patch.AudioCallbackRate()); 
+    // Block size, then the panel rate that goes with it
+    patch.SetAudioBlockSize(BootBlockSize());
+    const float callback_rate = patch.AudioCallbackRate();
+    control_every = static_cast<size_t>(callback_rate / TAPE_CONTROL_RATE + 0.5f);
+    if (control_every < 1) control_every = 1;
 
-    // Init DSP
-    for(int i=0; i<2; i++) {
-        delMems[i].Init();
-        heads[i].del = &delMems[i];
-    }
-    heads[0].Init(sample_rate, reverseBufferL);
-    heads[1].Init(sample_rate, reverseBufferR);
+    // The knobs' smoothing and the buttons' debouncing run at the panel
+    // rate: SetAudioBlockSize() set the knobs to the callback rate
+    const float panel_rate = callback_rate / static_cast<float>(control_every);
+    for (size_t i = 0; i < ADC_LAST; i++) patch.controls[i].SetSampleRate(panel_rate);
 
+    // Init Buttons D1 and D2
+    freeze_button.Init(DaisyPatchSM::D1, panel_rate);
+    mode_button.Init(DaisyPatchSM::D2, panel_rate);
+    InitClockInput();
+    InitTempoOutputs();
 
-    // Init Flutter LFOs
-    flutterLfo.Init(sample_rate);
-    flutterLfo.SetFreq(0.4f); flutterLfo.SetAmp(1.0f);
-    flutterLfo2.Init(sample_rate);
-    flutterLfo2.SetFreq(3.5f); flutterLfo2.SetAmp(0.3f);
-    flutterLfo2.SetWaveform(Oscillator::WAVE_TRI);
+    // Init DSP
+    core.Init(patch.AudioSampleRate(), &tapeMem);
+    core.SetNonlin(TAPE_NONLIN);
+    core.SetQuality(TAPE_QUALITY);
+    core.SetOversampling(TAPE_OVERSAMPLE);
+    core.SetReadPrefetch(TAPE_READ_PREFETCH);
+    core.SetReverseStyle(TAPE_REVERSE_STYLE);
+    core.SetHeadMode(TAPE_HEAD_MODE);
+    core.SetTopology(TAPE_TOPOLOGY);
+    core.SetInterp(TAPE_INTERP);
+    core.Profiler().Init(patch.AudioSampleRate(), patch.AudioBlockSize(), (float)System::GetSysClkFreq());
+
+#ifdef TAPE_PROFILE_LOG
+    patch.StartLog();
+    patch.PrintLine("block %u samples, panel every %u callbacks", static_cast<unsigned>(patch.AudioBlockSize()),
+                    static_cast<unsigned>(control_every));
+#endif
 
     patch.StartAudio(AudioCallback);
 
     while(1) {
-        // LED is ON for the first 10% of the delay cycle, OR when Reverse Mode is active, OR when Freeze Mode is active.
-        led.Write(led_phase < 0.1f || reverse_feedback_mode || freeze_mode); 
-        
+#ifdef TAPE_PROFILE_LOG
+        LogProfile();
+#endif
+
         System::Delay(1);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,642 @@
+/**
+ * Hardware-independent DSP primitives for the TapeDelay core.
+ *
+ * Everything in here is plain C++ with no libDaisy / DaisySP dependency so that
+ * the same code runs on the Patch SM and in the host tools (see host/).
+ * DelayLine and Oscillator mirror the DaisySP classes of the same name, sample
+ * for sample, so the firmware sounds the same as before the split.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace tape {
+
+constexpr float PI_F    = 3.1415927410125732421875f;
+constexpr float TWOPI_F = 2.0f * PI_F;
+
+// Compare/select rather than fminf/fmaxf: those are out-of-line libm calls on
+// x86 and would dominate every host measurement. NaN handling is the only
+// difference.
+inline float fclamp(float in, float min, float max) {
+    in = in < min ? min : in;
+    return in > max ? max : in;
+}
+
+// One pole lowpass used for parameter smoothing (same as daisysp::fonepole)
+inline void fonepole(float &out, float in, float coeff) {
+    out += coeff * (in - out);
+}
+
+// gen~ hTrap: trapezoid over a phase in [0, 1), rising from `lo` to `hi` up to
+// `up` and falling back from `down`. Loop ducking for the reverse heads.
+inline float hTrap(float ph, float lo, float hi, float up, float down) {
+    float phw = ph - floorf(ph);
+    float ucl = fclamp(up, 0.0f, 1.0f);
+    float dcl = fclamp(down, ucl, 1.0f);
+    float hml = hi - lo;
+    if (phw < ucl) return lo + hml * (phw / ucl);
+    if (phw > dcl) return lo + hml * (1.0f - (phw - dcl) / (1.0f - dcl));
+    return hi;
+}
+
+// --------------------------------------------------------------------------
+// NON-LINEARITIES (Ported from gen~)
+// --------------------------------------------------------------------------
+
+inline float tnhLam(float x) {
+    float x2 = x * x;
+    float a = (((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f) * x;
+    float b = ((28.0f * x2 + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+    return fclamp(a / b, -1.0f, 1.0f);
+}
+
+inline float polysat(float x) {              // polynomial saturation
+    float x2 = x * x;
+    float x3 = x * x2;
+    float p531 = (x + (x3 * -0.18963f)) + ((x3 * x2) * 0.016182f);
+    float pn = -1.875f > x ? -1.0f : p531;
+    float y = x > 1.875f ? 1.0f : pn;
+    return y * 0.999995f;
+}
+
+inline float cnl(float x) {                  // cubic non-linearity (quasi josIII)
+    x = fclamp(x, -1.0f, 1.0f);
+    return x * (1.0f - 0.333333f * x * x);
+}
+
+inline float parsat(float x0, float a0, float c1) {  // parabolic saturation
+    float x1 = fclamp(x0, -1.0f, 1.0f);
+    float c2 = c1 + c1;
+    float x2 = fclamp((x1 * a0), -c2, c2);
+    return x2 * (1.0f - (fabsf(x2) * (0.25f / c1)));
+}
+
+inline float tnhb(float x, float m) {       // modifiable tanh (tanh if m == -2, 'tape' if m == -5)
+    return (2.0f / (1.0f + expf(m * x))) - 1.0f;
+}
+
+// Curve modifiers for sat() at quality 2; `mod` comes from the envelope and
+// can exceed 1
+inline float tnhbMod(float mod) {            // gen~ scale(min(mod, 1), 1, 0, -5.067268, -1.098611, 0.38103)
+    float norm = 1.0f - (mod < 1.0f ? mod : 1.0f);
+    return -5.067268f + (-1.098611f + 5.067268f) * powf(norm, 0.38103f);
+}
+
+inline float parsatMap(int ind) {
+    return ind == 1 ? 0.6f : (ind == 2 ? 1.5f : 0.5f);
+}
+
+inline float parsatMod(float mod) {          // cosine step through parsatMap()
+    float feeder = mod * 2.0f;
+    int ate = static_cast<int>(feeder);
+    float ion = feeder - static_cast<float>(ate);
+    float map0 = parsatMap(ate);
+    float map1 = parsatMap(ate + 1);
+    return map0 + (map1 - map0) * (0.5f - 0.5f * cosf(ion * PI_F));
+}
+
+// --------------------------------------------------------------------------
+// APPROXIMATIONS (Ported from gen~)
+// --------------------------------------------------------------------------
+
+inline float expA(float x) {                 // approximates exp(2x)
+    x = x * 2.0f;
+    x = 0.999996f + (0.031261316f + (0.00048274797f + 0.000006f * x) * x) * x;
+    x *= x; x *= x; x *= x; x *= x;
+    return x * x;
+}
+
+inline float dbtoaA(float db) {              // dbtoa() through expA
+    return expA(db * 0.057564627f);          // ln(10) / 40
+}
+
+inline float cosApp01(float a) {             // approximates cos(2 pi a)
+    const float p = (a - floorf(a)) - 0.75f;
+    const float pa = fabsf(p);
+    const float cl = ((pa - 0.5f) * (pa - 0.924933f)) * (pa + 0.424933f);
+    const float cr = (((pa + 1.05802f) * pa) + 0.436501f) * ((pa * (pa - 2.05802f)) + 1.21551f);
+    return p * ((cl * cr) * 60.252201f);
+}
+
+inline float sinApp01(float a) {             // approximates sin(2 pi a)
+    return cosApp01(a - 0.25f);
+}
+
+inline float tnA(float x) {                  // approximates tan(x), for small x
+    const float x2 = x * x;
+    const float x3 = x2 * x;
+    const float x5 = x2 * x3;
+    return ((x5 * 0.133333f) + (x3 * 0.333333f)) + x;
+}
+
+inline float simpSat(float x) {              // passive saturation, clipped at +-1
+    x = fclamp(x, -1.0f, 1.0f);
+    return 0.5f * x * (3.0f - (x * x));
+}
+
+// gen~ fixdenorm, for recursive state once per block: anything under
+// -400 dB is zero. Far above the subnormals, so state that was kept from
+// them by the last flush cannot decay into them before the next one.
+inline float fixdenorm(float x) {
+    return (fabsf(x) < 1e-20f) ? 0.0f : x;
+}
+
+inline float softStatic(float x) {
+    if (x > 1.0f) return (1.0f - 4.0f / (x + 3.0f)) * 4.0f + 1.0f;
+    else if (x < -1.0f) return (1.0f + 4.0f / (x - 3.0f)) * -4.0f - 1.0f;
+    else return x;
+}
+
+// --------------------------------------------------------------------------
+// FILTERS
+// --------------------------------------------------------------------------
+
+// Coefficient of the gen~ 6dB one-pole, kept between blocks so that sinf()
+// only runs when the cutoff actually moves. One instance can feed any number
+// of filters at the same cutoff (e.g. both channels of the tone filter).
+class OnePoleCoeff {
+  public:
+    float f = 0.5f;
+
+    static float Compute(float cutoff, float sample_rate) {
+        return fclamp(sinf(cutoff * TWOPI_F / sample_rate), 0.00001f, 0.99999f);
+    }
+
+    // `smooth_ms` is the time constant of the control-rate cutoff glide
+    void Init(float sr, float cutoff, float smooth_ms = 10.0f) {
+        sample_rate_ = sr;
+        smooth_samples_ = smooth_ms * 0.001f * sr;
+        target_ = cutoff_ = cutoff;
+        block_ = 0;
+        f = Compute(cutoff_, sample_rate_);
+    }
+
+    void SetCutoff(float cutoff) { target_ = cutoff; }
+
+    // Call once per block of n samples: glides the cutoff toward the target
+    // and refreshes the coefficient only if it moved.
+    void Update(size_t n) {
+        if (cutoff_ == target_) return;
+        if (n != block_) {
+            block_ = n;
+            k_ = 1.0f - expf(-static_cast<float>(n) / smooth_samples_);
+        }
+        cutoff_ += k_ * (target_ - cutoff_);
+        if (fabsf(target_ - cutoff_) < 0.5f) cutoff_ = target_;
+        f = Compute(cutoff_, sample_rate_);
+    }
+
+  private:
+    float sample_rate_ = 48000.0f;
+    float smooth_samples_ = 480.0f;
+    float target_ = 1000.0f, cutoff_ = 1000.0f;
+    size_t block_ = 0;
+    float k_ = 1.0f;
+};
+
+struct OnePole6dB {
+    float y0 = 0.0f;
+    float sample_rate;
+    void Init(float sr) { sample_rate = sr; }
+    void Flush() { y0 = fixdenorm(y0); }
+    // Direct port of gen~ eAllPoleLPHP6, coefficient computed per call
+    float Process(float x, float cutoff, int type) {
+        float f = fclamp(sinf(cutoff * TWOPI_F / sample_rate), 0.00001f, 0.99999f);
+        float lp = y0 + f * (x - y0);
+        y0 = lp;
+        return (type == 1) ? lp - x : lp;
+    }
+    float Process(float x, const OnePoleCoeff &c, int type) {
+        float lp = y0 + c.f * (x - y0);
+        y0 = lp;
+        return (type == 1) ? lp - x : lp;
+    }
+    // Block version; `in` and `out` may alias
+    void ProcessBlock(const float *in, float *out, size_t n, const OnePoleCoeff &c, int type) {
+        const float f = c.f;
+        float y = y0;
+        if (type == 1) {
+            for (size_t i = 0; i < n; i++) {
+                const float x = in[i];
+                y += f * (x - y);
+                out[i] = y - x;
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                y += f * (in[i] - y);
+                out[i] = y;
+            }
+        }
+        y0 = y;
+    }
+};
+
+// gen~ ePoleZeroLPHP lowpass: 6 dB pole / zero. The gen~ patch computes
+// sin and cos per sample; here the coefficients are set when the cutoff moves.
+struct PoleZeroCoeff {
+    float a0 = 0.5f, a1 = 0.0f;
+
+    void Set(float cutoff, float sample_rate) {
+        const float fc = PI_F * fclamp(cutoff, 1.0f, sample_rate * 0.5f) / sample_rate;
+        const float s = sinf(fc), c = cosf(fc);
+        a0 = fminf((2.0f * s) / (c + s), 0.999999f);
+        a1 = 1.0f - (a0 * 2.0f);
+    }
+};
+
+struct PoleZeroLP {
+    float r = 0.0f;
+    void Flush() { r = fixdenorm(r); }
+    inline float Process(float x, const PoleZeroCoeff &c) {
+        const float w = x * c.a0;
+        const float lp = r + w;
+        r = w + (lp * c.a1);
+        return lp;
+    }
+};
+
+// gen~ SallenAndKey: 12 dB, trapezoidal integration, no non-linearity
+struct SallenKeyCoeff {
+    float k = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f, a4 = 1.0f, a5 = 0.0f;
+
+    void Set(float cutoff, float res, float sample_rate) {
+        const float g = tnA(PI_F * fclamp(cutoff, 1.0f, sample_rate * 0.45f) / sample_rate);
+        k = 2.0f * res;
+        const float gp1 = 1.0f + g;
+        const float a0 = 1.0f / ((gp1 * gp1) - (g * k));
+        a1 = k * a0;
+        a2 = gp1 * a0;
+        a3 = g * a2;
+        a4 = 1.0f / gp1;
+        a5 = g * a4;
+    }
+};
+
+struct SallenKey {
+    float ic1eq = 0.0f, ic2eq = 0.0f;
+    void Flush() {
+        ic1eq = fixdenorm(ic1eq);
+        ic2eq = fixdenorm(ic2eq);
+    }
+    // TYPE 0 lowpass, 1 the gen~ highpass hack (input minus lowpass)
+    template <int TYPE>
+    inline float Process(float v0, const SallenKeyCoeff &c) {
+        const float v1 = (c.a1 * ic2eq) + (c.a2 * ic1eq) + (c.a3 * v0);
+        const float v2 = (c.a4 * ic2eq) + (c.a5 * v1);
+        ic1eq = (2.0f * (v1 - (c.k * v2))) - ic1eq;
+        ic2eq = (2.0f * v2) - ic2eq;
+        return (TYPE == 1) ? v0 - v2 : v2;
+    }
+};
+
+// gen~ LoresHipass: a resonant lowpass like MSP [lores~], flipped into a
+// dirty highpass
+struct LoresCoeff {
+    float scl = 0.0f, r2 = 0.0f, gain = 1.0f;
+
+    void Set(float cutoff, float q, float sample_rate) {
+        const float frad = cosf(cutoff * TWOPI_F / sample_rate);
+        const float res = 0.882497f * expf(q * 0.125f);
+        scl = (frad * res) * -2.0f;
+        r2 = res * res;
+        gain = (scl + r2) + 1.0f;
+    }
+};
+
+struct LoresHipass {
+    float ya = 0.0f, yb = 0.0f;
+    void Flush() {
+        ya = fixdenorm(ya);
+        yb = fixdenorm(yb);
+    }
+    inline float Process(float x, const LoresCoeff &c) {
+        const float o = x * c.gain - ((c.scl * ya) + (c.r2 * yb));
+        yb = ya;
+        ya = o;
+        return x - o;
+    }
+};
+
+// gen~ dcblock(): first-order DC blocker with the pole at 0.9997
+struct DcBlock {
+    float x1 = 0.0f, y1 = 0.0f;
+    void Flush() {
+        x1 = fixdenorm(x1);
+        y1 = fixdenorm(y1);
+    }
+    inline float Process(float x) {
+        float y = x - x1 + 0.9997f * y1;
+        x1 = x;
+        y1 = y;
+        return y;
+    }
+};
+
+// --------------------------------------------------------------------------
+// DELAY LINE
+// --------------------------------------------------------------------------
+
+// 4-point, 3rd-order Hermite between x0 and x1 (daisysp::DelayLine::ReadHermite)
+inline float Hermite4(float xm1, float x0, float x1, float x2, float f) {
+    const float c = (x1 - xm1) * 0.5f;
+    const float v = x0 - x1;
+    const float w = c + v;
+    const float a = w + v + (x2 - x0) * 0.5f;
+    const float b_neg = w + a;
+    return (((a * f) - b_neg) * f + c) * f + x0;
+}
+
+// Tape head interpolators, as policies for StereoTape::Read() and
+// TapeWindow::Read(). Apply() gets the four frames around a read, xm1 x0 x1
+// x2 at p[0], p[STRIDE], p[2 STRIDE], p[3 STRIDE], and the fraction f of the
+// way from x0 to x1; each reads only the taps it needs. All are linear in
+// the taps, so the format's UNIT still scales the result afterwards.
+template <size_t STRIDE>
+struct InterpPolicies {
+    // The nearest tap alone: exact when the read is on a whole sample
+    struct None {
+        template <typename S>
+        static inline float Apply(const S *p, float f) { return (f < 0.5f) ? p[STRIDE] : p[2 * STRIDE]; }
+    };
+    struct Linear {
+        template <typename S>
+        static inline float Apply(const S *p, float f) {
+            const float x0 = p[STRIDE];
+            return x0 + f * (static_cast<float>(p[2 * STRIDE]) - x0);
+        }
+    };
+    // gen~ interp="cosine", with the smoothstep f^2 (3 - 2 f) for the
+    // raised-cosine weight as in SatTable::LookupCosine (at most 1 % of the
+    // step between the taps apart)
+    struct Cosine {
+        template <typename S>
+        static inline float Apply(const S *p, float f) {
+            const float x0 = p[STRIDE];
+            return x0 + (f * f * (3.0f - 2.0f * f)) * (static_cast<float>(p[2 * STRIDE]) - x0);
+        }
+    };
+    // gen~ interp="cubic"
+    struct Cubic {
+        template <typename S>
+        static inline float Apply(const S *p, float f) {
+            const float xm1 = p[0], x0 = p[STRIDE], x1 = p[2 * STRIDE], x2 = p[3 * STRIDE];
+            const float a0 = x2 - x1 - xm1 + x0;
+            const float a1 = xm1 - x0 - a0;
+            const float a2 = x1 - xm1;
+            return ((a0 * f + a1) * f + a2) * f + x0;
+        }
+    };
+    struct Hermite {
+        template <typename S>
+        static inline float Apply(const S *p, float f) {
+            return Hermite4(p[0], p[STRIDE], p[2 * STRIDE], p[3 * STRIDE], f);
+        }
+    };
+};
+
+// On the interleaved tape (L/R frames)
+using InterpNone = InterpPolicies<2>::None;
+using InterpLinear = InterpPolicies<2>::Linear;
+using InterpCosine = InterpPolicies<2>::Cosine;
+using InterpCubic = InterpPolicies<2>::Cubic;
+using InterpHermite = InterpPolicies<2>::Hermite;
+
+// Circular buffer with the same write/read conventions as daisysp::DelayLine:
+// Write() stores at the write pointer and then moves it backwards, so a read
+// of `delay` samples looks `delay` slots ahead of the write pointer.
+template <typename T, size_t max_size>
+class DelayLine {
+  public:
+    void Init() { Reset(); }
+
+    void Reset() {
+        for (size_t i = 0; i < max_size; i++) line_[i] = T(0);
+        write_ptr_ = 0;
+    }
+
+    inline void Write(const T sample) {
+        line_[write_ptr_] = sample;
+        write_ptr_ = (write_ptr_ - 1 + max_size) % max_size;
+    }
+
+    inline T Read(size_t delay) const {
+        return line_[(write_ptr_ + delay) % max_size];
+    }
+
+    inline T ReadHermite(float delay) const {
+        int32_t delay_integral = static_cast<int32_t>(delay);
+        float delay_fractional = delay - static_cast<float>(delay_integral);
+
+        int32_t t = (write_ptr_ + delay_integral + max_size);
+        const T xm1 = line_[(t - 1) % max_size];
+        const T x0  = line_[(t) % max_size];
+        const T x1  = line_[(t + 1) % max_size];
+        const T x2  = line_[(t + 2) % max_size];
+        return Hermite4(xm1, x0, x1, x2, delay_fractional);
+    }
+
+  private:
+    size_t write_ptr_ = 0;
+    T line_[max_size];
+};
+
+// Tape sample formats. StereoTape stores S and converts on write; reads
+// interpolate the stored values and scale the result by UNIT (Hermite is
+// linear in its taps, so that is one multiply per read, not four).
+template <typename S>
+struct TapeFormat;
+
+template <>
+struct TapeFormat<float> {
+    static constexpr float UNIT = 1.0f;
+    static inline float Store(float x) { return x; }
+};
+
+// 16-bit with +-2.0 full scale: 6 dB of headroom over the saturator, noise
+// floor around -96 dB re 1.0 (`tape_bench format`). Louder writes clip.
+template <>
+struct TapeFormat<int16_t> {
+    static constexpr float SCALE = 16384.0f;
+    static constexpr float UNIT = 1.0f / SCALE;
+    static inline int16_t Store(float x) {
+        // Offset to positive so the truncating conversion rounds to nearest
+        float v = fclamp(x * SCALE + 32768.5f, 0.0f, 65535.0f);
+        return static_cast<int16_t>(static_cast<int32_t>(v) - 32768);
+    }
+};
+
+// Two-channel tape: L/R interleaved frame by frame behind one write pointer,
+// so a stereo read fetches both channels' taps from the same cache lines and
+// SDRAM row. Same pointer conventions as DelayLine.
+//
+// Writes are addressed relative to the write pointer (`offset` samples into
+// the current block) and the pointer moves once per block with Advance(), so
+// each channel can write its block separately. A channel may write `skew`
+// frames ahead of its position; reading that lane at `delay` then returns the
+// channel delayed by `delay + skew`. This is how the right channel keeps its
+// fixed offset while sharing the left channel's read position.
+//
+// Samples are stored as S (see TapeFormat).
+template <size_t max_size, typename S = float>
+class StereoTape {
+  public:
+    using Sample = S;
+    static constexpr size_t LENGTH = max_size;   // frames
+
+    void Init() { Reset(); }
+
+    void Reset() {
+        for (size_t i = 0; i < 2 * max_size; i++) line_[i] = 0;
+        write_ptr_ = 0;
+    }
+
+    // Lane `ch` of the frame for sample `offset` of the current block (plus
+    // the lane's skew)
+    inline void Write(size_t ch, size_t offset, float sample) {
+        size_t frame = (write_ptr_ + max_size - (offset % max_size)) % max_size;
+        line_[2 * frame + ch] = TapeFormat<S>::Store(sample);
+    }
+
+    // n consecutive samples of lane `ch`, starting at sample `offset`
+    inline void WriteBlock(size_t ch, size_t offset, const float *src, size_t n) {
+        size_t frame = (write_ptr_ + max_size - (offset % max_size)) % max_size;
+        for (size_t k = 0; k < n; k++) {
+            line_[2 * frame + ch] = TapeFormat<S>::Store(src[k]);
+            frame = (frame == 0) ? max_size - 1 : frame - 1;
+        }
+    }
+
+    // Moves the write pointer past a block of n frames
+    inline void Advance(size_t n) {
+        write_ptr_ = (write_ptr_ + max_size - (n % max_size)) % max_size;
+    }
+
+    // The `count` frames starting `first` ahead of the write pointer as one
+    // contiguous run of interleaved samples, or nullptr if they wrap
+    inline const S *Frames(int32_t first, size_t count) const {
+        size_t t = (write_ptr_ + static_cast<size_t>(first)) % max_size;
+        return (t + count <= max_size) ? &line_[2 * t] : nullptr;
+    }
+
+    // One lane, `delay` (>= 1) frames ahead of the write pointer, through
+    // interpolator I (InterpHermite etc.)
+    template <typename I>
+    inline float Read(size_t ch, float delay) const {
+        float f;
+        const S *p = Taps(delay, f);
+        return I::Apply(p + ch, f) * TapeFormat<S>::UNIT;
+    }
+
+    // Both lanes at the same position
+    template <typename I>
+    inline void Read(float delay, float &l, float &r) const {
+        float f;
+        const S *p = Taps(delay, f);
+        l = I::Apply(p, f) * TapeFormat<S>::UNIT;
+        r = I::Apply(p + 1, f) * TapeFormat<S>::UNIT;
+    }
+
+    inline float ReadHermite(size_t ch, float delay) const { return Read<InterpHermite>(ch, delay); }
+    inline void ReadHermite(float delay, float &l, float &r) const { Read<InterpHermite>(delay, l, r); }
+
+  private:
+    // Points at the four tap frames: straight into the line when they are
+    // contiguous, otherwise gathered across the wrap into scratch_
+    inline const S *Taps(float delay, float &frac) const {
+        int32_t delay_integral = static_cast<int32_t>(delay);
+        frac = delay - static_cast<float>(delay_integral);
+        size_t t = write_ptr_ + static_cast<size_t>(delay_integral);
+        if (t >= max_size) t -= max_size;
+        if (t >= 1 && t + 2 < max_size) {
+            return &line_[2 * (t - 1)];
+        }
+        for (size_t k = 0; k < 4; k++) {
+            size_t frame = (t + max_size - 1 + k) % max_size;
+            scratch_[2 * k] = line_[2 * frame];
+            scratch_[2 * k + 1] = line_[2 * frame + 1];
+        }
+        return scratch_;
+    }
+
+    size_t write_ptr_ = 0;
+    mutable S scratch_[8];
+    S line_[2 * max_size];
+};
+
+// Read-only view of frames copied out of a StereoTape (see Frames()): the
+// same reads, addressed from the tape's write pointer as before the copy.
+template <typename S>
+struct TapeWindow {
+    const S *frames;       // interleaved L/R
+    int32_t first;         // frames[0] is this many frames ahead of the write pointer
+
+    template <typename I>
+    inline void Read(float delay, float &l, float &r) const {
+        int32_t delay_integral = static_cast<int32_t>(delay);
+        float f = delay - static_cast<float>(delay_integral);
+        const S *p = frames + 2 * (delay_integral - first - 1);
+        l = I::Apply(p, f) * TapeFormat<S>::UNIT;
+        r = I::Apply(p + 1, f) * TapeFormat<S>::UNIT;
+    }
+
+    template <typename I>
+    inline float Read(size_t ch, float delay) const {
+        int32_t delay_integral = static_cast<int32_t>(delay);
+        float f = delay - static_cast<float>(delay_integral);
+        const S *p = frames + 2 * (delay_integral - first - 1) + ch;
+        return I::Apply(p, f) * TapeFormat<S>::UNIT;
+    }
+
+    inline void ReadHermite(float delay, float &l, float &r) const { Read<InterpHermite>(delay, l, r); }
+    inline float ReadHermite(size_t ch, float delay) const { return Read<InterpHermite>(ch, delay); }
+};
+
+// --------------------------------------------------------------------------
+// LFO
+// --------------------------------------------------------------------------
+
+// Sine / triangle subset of daisysp::Oscillator, enough for the flutter LFOs
+class Oscillator {
+  public:
+    enum { WAVE_SIN, WAVE_TRI };
+
+    void Init(float sample_rate) {
+        sr_recip_ = 1.0f / sample_rate;
+        freq_ = 100.0f;
+        amp_ = 0.5f;
+        phase_ = 0.0f;
+        waveform_ = WAVE_SIN;
+        CalcPhaseInc();
+    }
+
+    void SetFreq(float f) { freq_ = f; CalcPhaseInc(); }
+    void SetAmp(float a) { amp_ = a; }
+    void SetWaveform(uint8_t wf) { waveform_ = wf; }
+
+    float Process() {
+        float out;
+        if (waveform_ == WAVE_TRI) {
+            float t = -1.0f + (2.0f * phase_ / TWOPI_F);
+            out = 2.0f * (fabsf(t) - 0.5f);
+        } else {
+            out = sinf(phase_);
+        }
+        phase_ += phase_inc_;
+        if (phase_ > TWOPI_F) phase_ -= TWOPI_F;
+        return out * amp_;
+    }
+
+  private:
+    void CalcPhaseInc() { phase_inc_ = (TWOPI_F * freq_) * sr_recip_; }
+
+    float   amp_ = 0.5f, freq_ = 100.0f;
+    float   sr_recip_ = 1.0f / 48000.0f;
+    float   phase_ = 0.0f, phase_inc_ = 0.0f;
+    uint8_t waveform_ = WAVE_SIN;
+};
+
+} // namespace tape
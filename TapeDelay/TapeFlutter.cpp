@@ -0,0 +1,88 @@
+#include "TapeFlutter.h"
+
+#include "TapeDsp.h"
+
+namespace tape {
+
+void FlutterMod::Init(float sample_rate) {
+    const float step = static_cast<float>(STEP) / sample_rate;
+    wow_inc_ = 0.4f * step;
+    flutter_inc_ = 3.5f * step;
+    drift_inc_ = 1.1f * step;
+
+    // Every component starts at zero, so the wobble does too
+    wow_phase_ = 0.0f;
+    flutter_phase_ = 0.25f;
+    drift_phase_ = 0.0f;
+    seed_ = 0x2545f491u;
+    drift_[0] = Random();
+    drift_[1] = 0.0f;
+    drift_[2] = Random();
+    drift_[3] = Random();
+
+    for (size_t k = 0; k < HISTORY; k++) hist_[k] = 0.0f;
+    head_ = 0;
+    count_ = STEP;
+    from_ = to_ = skew_from_ = skew_to_ = 0.0f;
+}
+
+float FlutterMod::Random() {
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return static_cast<float>(static_cast<int32_t>(seed_)) * (1.0f / 2147483648.0f);
+}
+
+float FlutterMod::Shape() {
+    const float wow = sinApp01(wow_phase_);
+    const float flutter = 4.0f * fabsf(flutter_phase_ - 0.5f) - 1.0f;
+    const float drift = Hermite4(drift_[0], drift_[1], drift_[2], drift_[3], drift_phase_);
+
+    wow_phase_ += wow_inc_;
+    if (wow_phase_ >= 1.0f) wow_phase_ -= 1.0f;
+    flutter_phase_ += flutter_inc_;
+    if (flutter_phase_ >= 1.0f) flutter_phase_ -= 1.0f;
+    drift_phase_ += drift_inc_;
+    if (drift_phase_ >= 1.0f) {
+        drift_phase_ -= 1.0f;
+        drift_[0] = drift_[1];
+        drift_[1] = drift_[2];
+        drift_[2] = drift_[3];
+        drift_[3] = Random();
+    }
+
+    // The old pair of LFOs (sine + 0.15 triangle) plus the drift
+    return wow + 0.15f * flutter + 0.3f * drift;
+}
+
+bool FlutterMod::Process(const Ramp &depth, float *wobble, float *skew, size_t n) {
+    if (depth.from <= 0.0f && !depth.Moving()) return false;
+
+    // SKEW samples back from a control point, between two older ones
+    constexpr size_t back = SKEW / STEP;
+    constexpr float back_frac = static_cast<float>(SKEW % STEP) / static_cast<float>(STEP);
+    constexpr float k_step = 1.0f / static_cast<float>(STEP);
+
+    for (size_t i = 0; i < n; i++) {
+        if (count_ == STEP) {
+            from_ = to_;
+            skew_from_ = skew_to_;
+            to_ = Shape();
+            head_ = (head_ + 1) % HISTORY;
+            hist_[head_] = to_;
+            const float a = hist_[(head_ + HISTORY - back) % HISTORY];
+            const float b = hist_[(head_ + HISTORY - back - 1) % HISTORY];
+            skew_to_ = (a + (b - a) * back_frac) - to_;
+            count_ = 0;
+        }
+        const float k = static_cast<float>(count_) * k_step;
+        const float d = depth.At(i);
+        wobble[i] = (from_ + (to_ - from_) * k) * d;
+        skew[i] = (skew_from_ + (skew_to_ - skew_from_) * k) * d;
+        count_++;
+    }
+    return true;
+}
+
+} // namespace tape
@@ -0,0 +1,66 @@
+/**
+ * Tape wow and flutter: the wobble of the read head's delay.
+ *
+ * Three components, summed and scaled by the Flutter knob:
+ *   wow      0.4 Hz sine (gen~ sinApp01)
+ *   flutter  3.5 Hz triangle
+ *   drift    a random oscillator, cubic-interpolated through a new random
+ *            point every ~0.9 s, so no two cycles are alike
+ *
+ * The shape is only computed every STEP samples and linearly interpolated
+ * in between, which is exact for the triangle and far below audibility for
+ * the rest. With the knob at zero nothing runs at all.
+ *
+ * The right channel's head follows the same wobble SKEW samples later (gen~
+ * mungephase: the flutter is written into a short delay and read back for
+ * the right head), so the two sides drift slightly apart in pitch.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "TapeParams.h"
+
+namespace tape {
+
+class FlutterMod {
+  public:
+    // Samples between control points
+    static constexpr size_t STEP = 16;
+    // How much later the right head follows the wobble (gen~ mungephase read)
+    static constexpr size_t SKEW = 606;
+
+    void Init(float sample_rate);
+
+    // The next n samples of wobble, in samples of delay (within about
+    // +-1.4 depth), and the right head's wobble minus the left's. With depth
+    // at 0 and staying there the modulator stands still, writes nothing and
+    // returns false.
+    bool Process(const Ramp &depth, float *wobble, float *skew, size_t n);
+
+  private:
+    // Next control point of the wobble at depth 1
+    float Shape();
+    // Uniform in [-1, 1)
+    float Random();
+
+    float wow_inc_ = 0.0f, flutter_inc_ = 0.0f, drift_inc_ = 0.0f;
+    float wow_phase_ = 0.0f, flutter_phase_ = 0.0f, drift_phase_ = 0.0f;
+    float drift_[4] = {};   // random points the drift passes through
+    uint32_t seed_ = 1;
+
+    // Control points, newest at hist_[head_], far enough back for the skew
+    static constexpr size_t HISTORY = SKEW / STEP + 3;
+    float hist_[HISTORY] = {};
+    size_t head_ = 0;
+
+    // Samples since the last control point, and the segments between the
+    // last two control points of the wobble and the skew
+    size_t count_ = STEP;
+    float from_ = 0.0f, to_ = 0.0f;
+    float skew_from_ = 0.0f, skew_to_ = 0.0f;
+};
+
+} // namespace tape
@@ -0,0 +1,218 @@
+/**
+ * Control-rate parameter handling: knob jitter filtering and the gen~
+ * smoothers.
+ *
+ * The panel is read once per callback. Each knob goes through Hysteresis,
+ * so ADC noise does not count as a change and whatever is derived from the
+ * knob (powf curves, filter coefficients, envelope settings) is only
+ * recomputed when it really moves. Parameters that must not step at block
+ * edges then glide through a Smoother, which advances a whole block at once
+ * and hands out a linear per-sample Ramp across it.
+ *
+ * The smoothing laws are the gen~ patch's own, compensated for the sample
+ * rate: the gen~ amounts are taken as meant at 44.1 kHz.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "TapeDsp.h"
+
+namespace tape {
+
+// ADC jitter filter: the output jumps to the input once it is more than
+// `width` away, and ignores anything closer
+class Hysteresis {
+  public:
+    void Init(float width) {
+        width_ = width;
+        primed_ = false;
+    }
+
+    // True when the output changed (always on the first call)
+    bool Process(float x) {
+        if (primed_ && fabsf(x - y_) <= width_) return false;
+        primed_ = true;
+        y_ = x;
+        return true;
+    }
+
+    float Value() const { return y_; }
+
+  private:
+    float width_ = 0.0f;
+    float y_ = 0.0f;
+    bool primed_ = false;
+};
+
+// A parameter over one block: from + step * (i + 1) at sample i, so the
+// last sample lands on the end value
+struct Ramp {
+    float from = 0.0f;
+    float step = 0.0f;
+
+    float At(size_t i) const { return from + step * static_cast<float>(i + 1); }
+    bool Moving() const { return step != 0.0f; }
+};
+
+// --------------------------------------------------------------------------
+// SMOOTHING LAWS: per-sample one-pole coefficient at sample rate sr
+// --------------------------------------------------------------------------
+
+// smpsmooth: `s` is the gen~ amount (0.9995), the fraction kept per sample
+struct SmpSmooth {
+    static float Coeff(float s, float sr) { return 1.0f - powf(s, 44100.0f / sr); }
+};
+
+// cpsm: `f` is the gen~ amount (0.999); gen~ already compensates this one
+struct Cpsm {
+    static float Coeff(float f, float sr) {
+        const float k = (1.0f - f) * (44100.0f / sr);
+        return k < 1.0f ? k : 1.0f;
+    }
+};
+
+// rsmooth: `s` is the time to fall 6 dB, in seconds
+struct RSmooth {
+    static float Coeff(float s, float sr) {
+        const float k = 0.693147f / (s * sr);
+        return k < 1.0f ? k : 1.0f;
+    }
+};
+
+// p_SlideLite: `u` is the glide in samples at 44.1 kHz, as gen~ counts it
+struct SlideLite {
+    static float Coeff(float u, float sr) {
+        const float s = u * (sr / 44100.0f);
+        return 1.0f / (s > 1.0f ? s : 1.0f);
+    }
+};
+
+// One-pole glide y += (x - y) * k after one of the laws above, with its own
+// coefficient for rising and falling (p_SlideLite; the same for the rest).
+// With `step` > 1 each Process() call stands for that many samples and the
+// coefficients are compounded to match.
+template <typename Law>
+class Smoother {
+  public:
+    void Init(float sr, float amount, size_t step = 1) {
+        sr_ = sr;
+        step_ = step;
+        Set(amount, amount);
+        y_ = target_ = 0.0f;
+    }
+
+    // New amounts (Law units) for rising and falling
+    void Set(float up, float down) {
+        up_ = Compound(Law::Coeff(up, sr_), step_);
+        down_ = Compound(Law::Coeff(down, sr_), step_);
+        block_ = 0;
+    }
+
+    // Jump straight to `value`
+    void Reset(float value) { y_ = target_ = value; }
+
+    float Value() const { return y_; }
+
+    // fixdenorm on the output, once per block (for a glide toward zero)
+    void Flush() { y_ = fixdenorm(y_); }
+
+    // One step toward x (the gen~ function itself)
+    float Process(float x) {
+        y_ += (x - y_) * (x > y_ ? up_ : down_);
+        return y_;
+    }
+
+    // n samples toward x at once; the values in between are interpolated
+    // linearly. Within `settle` of x it snaps there and stops ramping.
+    Ramp Advance(float x, size_t n, float settle = 1e-4f) {
+        Ramp r = {y_, 0.0f};
+        if (y_ == x) return r;
+        if (n != block_ || x != target_) {
+            // The direction only changes with a new target
+            block_ = n;
+            target_ = x;
+            k_ = Compound(x > y_ ? up_ : down_, n);
+        }
+        y_ += (x - y_) * k_;
+        if (fabsf(x - y_) < settle) y_ = x;
+        r.step = (y_ - r.from) / static_cast<float>(n);
+        return r;
+    }
+
+  private:
+    // k applied n times in a row
+    static float Compound(float k, size_t n) {
+        return (n == 1) ? k : 1.0f - powf(1.0f - k, static_cast<float>(n));
+    }
+
+    float sr_ = 48000.0f;
+    size_t step_ = 1;
+    float up_ = 1.0f, down_ = 1.0f;
+    float y_ = 0.0f;
+
+    // Block coefficient for the last block size and target
+    size_t block_ = 0;
+    float target_ = 0.0f;
+    float k_ = 1.0f;
+};
+
+// Exponential glide toward a target that moves at most once per block, kept
+// as the distance still to go so that it arrives in float precision (a
+// plain one-pole stalls short of large values: at 100000 samples a step of
+// 0.0005 of the distance stops moving 8 samples away). Advance() hands out
+// a block as a linear Ramp between the curve's values at the block edges.
+class Glide {
+  public:
+    // `ms` is the time constant: a jump is 63 % covered after that long
+    void Init(float sr, float ms) {
+        sr_ = sr;
+        SetTime(ms);
+        target_ = dist_ = 0.0f;
+    }
+
+    void SetTime(float ms) {
+        ms_ = (ms > 0.0f) ? ms : 0.0f;
+        block_ = 0;
+    }
+    float Time() const { return ms_; }
+
+    // Jump straight to `value`
+    void Reset(float value) {
+        target_ = value;
+        dist_ = 0.0f;
+    }
+
+    float Value() const { return target_ - dist_; }
+
+    // n samples toward x. Within `settle` of x it lands there and stops.
+    Ramp Advance(float x, size_t n, float settle) {
+        const float from = target_ - dist_;
+        if (x != target_) {
+            dist_ = x - from;
+            target_ = x;
+        }
+        if (dist_ == 0.0f) return {from, 0.0f};
+        if (n != block_) {
+            block_ = n;
+            keep_ = (ms_ > 0.0f) ? expf(-1000.0f * static_cast<float>(n) / (ms_ * sr_)) : 0.0f;
+        }
+        dist_ *= keep_;
+        if (fabsf(dist_) < settle) dist_ = 0.0f;
+        return {from, (target_ - dist_ - from) / static_cast<float>(n)};
+    }
+
+  private:
+    float sr_ = 48000.0f;
+    float ms_ = 0.0f;
+    float target_ = 0.0f;
+    float dist_ = 0.0f;
+
+    // Fraction of the distance left after a block of block_ samples
+    size_t block_ = 0;
+    float keep_ = 0.0f;
+};
+
+} // namespace tape
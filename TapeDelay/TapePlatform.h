@@ -0,0 +1,120 @@
+/**
+ * The few places where the DSP core has to know what it is running on.
+ *
+ * The firmware build targets the STM32H750 (Cortex-M7); the host build defines
+ * TAPE_HOST (see host/Makefile). Everything here compiles to nothing or to a
+ * plain std:: fallback on the host.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef TAPE_HOST
+#include <chrono>
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+#endif
+
+namespace tape {
+
+// --------------------------------------------------------------------------
+// MEMORY PLACEMENT
+// --------------------------------------------------------------------------
+
+// Zero-wait-state DTCM (128 KB, shared with the stack) for small, hot tables
+// and filter state. Plain .bss on the host.
+#ifdef TAPE_HOST
+#define TAPE_DTCM_BSS
+#else
+#define TAPE_DTCM_BSS __attribute__((section(".dtcmram_bss")))
+#endif
+
+// --------------------------------------------------------------------------
+// CYCLE COUNTER
+// --------------------------------------------------------------------------
+
+#ifdef TAPE_HOST
+
+// Ticks are nanoseconds of std::chrono::steady_clock on the host
+constexpr const char *CYCLE_UNIT = "ns";
+
+inline void EnableCycleCounter() {}
+
+inline uint32_t CycleCount() {
+    using namespace std::chrono;
+    return static_cast<uint32_t>(
+        duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+#else
+
+// Ticks are CPU cycles from the Cortex-M7 DWT cycle counter
+constexpr const char *CYCLE_UNIT = "cycles";
+
+inline void EnableCycleCounter() {
+    volatile uint32_t *demcr  = reinterpret_cast<volatile uint32_t *>(0xE000EDFCu);
+    volatile uint32_t *lar    = reinterpret_cast<volatile uint32_t *>(0xE0001FB0u);
+    volatile uint32_t *cyccnt = reinterpret_cast<volatile uint32_t *>(0xE0001004u);
+    volatile uint32_t *ctrl   = reinterpret_cast<volatile uint32_t *>(0xE0001000u);
+    *demcr |= (1u << 24);   // TRCENA
+    *lar = 0xC5ACCE55u;     // the M7 DWT is locked out of reset
+    *cyccnt = 0;
+    *ctrl |= 1u;            // CYCCNTENA
+}
+
+inline uint32_t CycleCount() {
+    return *reinterpret_cast<volatile uint32_t *>(0xE0001004u);
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+// DENORMALS
+// --------------------------------------------------------------------------
+
+// Flush-to-zero for the audio thread: results that would be subnormal come
+// out as zero (and on x86 subnormal inputs are read as zero too), so a
+// dying echo never drops onto the FPU's slow path. Put one at the top of
+// the audio callback; the old mode comes back when it goes out of scope.
+// On the M7 this is FPSCR.FZ, which is part of the exception context, so
+// it only covers the handler it is set in.
+class ScopedFlushToZero {
+  public:
+    ScopedFlushToZero() : saved_(Get()) { Set(saved_ | BITS); }
+    ~ScopedFlushToZero() { Set(saved_); }
+    ScopedFlushToZero(const ScopedFlushToZero &) = delete;
+    ScopedFlushToZero &operator=(const ScopedFlushToZero &) = delete;
+
+  private:
+#if !defined(TAPE_HOST)
+    static constexpr uint32_t BITS = 1u << 24;   // FPSCR.FZ
+    static uint32_t Get() {
+        uint32_t r;
+        asm volatile("vmrs %0, fpscr" : "=r"(r));
+        return r;
+    }
+    static void Set(uint32_t r) { asm volatile("vmsr fpscr, %0" : : "r"(r) : "memory"); }
+#elif defined(__SSE__) || defined(__x86_64__)
+    static constexpr uint32_t BITS = 0x8040u;    // MXCSR FTZ | DAZ
+    static uint32_t Get() { return _mm_getcsr(); }
+    static void Set(uint32_t r) { _mm_setcsr(r); }
+#elif defined(__aarch64__)
+    static constexpr uint32_t BITS = 1u << 24;   // FPCR.FZ
+    static uint32_t Get() {
+        uint64_t r;
+        asm volatile("mrs %0, fpcr" : "=r"(r));
+        return static_cast<uint32_t>(r);
+    }
+    static void Set(uint32_t r) { asm volatile("msr fpcr, %0" : : "r"(static_cast<uint64_t>(r)) : "memory"); }
+#else
+    static constexpr uint32_t BITS = 0;
+    static uint32_t Get() { return 0; }
+    static void Set(uint32_t) {}
+#endif
+
+    uint32_t saved_;
+};
+
+} // namespace tape
@@ -0,0 +1,79 @@
+#include "TapePrefetch.h"
+
+#include <cstdint>
+
+#include "TapePlatform.h"
+
+#ifdef TAPE_HOST
+#include <cstring>
+#else
+#include "stm32h7xx_hal.h"
+#endif
+
+namespace tape {
+
+static uint32_t TAPE_DTCM_BSS staging[ReadPrefetch::BYTES / sizeof(uint32_t)];
+
+const void *ReadPrefetch::Staging() const {
+    return staging;
+}
+
+#ifdef TAPE_HOST
+
+void ReadPrefetch::Init() {}
+
+void ReadPrefetch::Start(const void *src, size_t bytes) {
+    memcpy(staging, src, bytes);
+}
+
+bool ReadPrefetch::Wait() {
+    return true;
+}
+
+#else
+
+// Channel 0 is not used by libDaisy
+static MDMA_HandleTypeDef mdma;
+
+void ReadPrefetch::Init() {
+    __HAL_RCC_MDMA_CLK_ENABLE();
+    mdma.Instance = MDMA_Channel0;
+    mdma.Init.Request = MDMA_REQUEST_SW;
+    mdma.Init.TransferTriggerMode = MDMA_BLOCK_TRANSFER;
+    mdma.Init.Priority = MDMA_PRIORITY_VERY_HIGH;
+    mdma.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+    mdma.Init.SourceInc = MDMA_SRC_INC_WORD;
+    mdma.Init.DestinationInc = MDMA_DEST_INC_WORD;
+    mdma.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+    mdma.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+    mdma.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+    mdma.Init.BufferTransferLength = 128;
+    mdma.Init.SourceBurst = MDMA_SOURCE_BURST_32BEATS;   // 32 words = one buffer
+    mdma.Init.DestBurst = MDMA_DEST_BURST_32BEATS;
+    mdma.Init.SourceBlockAddressOffset = 0;
+    mdma.Init.DestBlockAddressOffset = 0;
+    HAL_MDMA_Init(&mdma);
+}
+
+void ReadPrefetch::Start(const void *src, size_t size) {
+    const uint32_t bytes = static_cast<uint32_t>(size);
+    // The heads write the tape through the write-back D-cache: push any dirty
+    // lines of the span out to SDRAM before the MDMA reads it. DTCM is not
+    // cached, so the staging side needs nothing.
+    uintptr_t begin = reinterpret_cast<uintptr_t>(src) & ~static_cast<uintptr_t>(31);
+    uintptr_t end = reinterpret_cast<uintptr_t>(src) + bytes;
+    SCB_CleanDCache_by_Addr(reinterpret_cast<uint32_t *>(begin), static_cast<int32_t>(end - begin));
+    HAL_MDMA_Start(&mdma, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(src)),
+                   static_cast<uint32_t>(reinterpret_cast<uintptr_t>(staging)), bytes, 1);
+}
+
+bool ReadPrefetch::Wait() {
+    if (HAL_MDMA_PollForTransfer(&mdma, HAL_MDMA_FULL_TRANSFER, 1) == HAL_OK) return true;
+    // Leave the channel idle for the next block's Start()
+    HAL_MDMA_Abort(&mdma);
+    return false;
+}
+
+#endif
+
+} // namespace tape
@@ -0,0 +1,40 @@
+/**
+ * Staged tape reads.
+ *
+ * The tape lives in SDRAM, where every cache miss of the interpolating read
+ * stalls the core. Once the block's read positions are known, the span of
+ * tape they touch (a few hundred frames) is copied into a DTCM staging
+ * buffer in one burst. On the Cortex-M7 the copy is an MDMA block transfer,
+ * the only DMA that can write DTCM, so the CPU can do other work while it
+ * runs. The host does the same copy with memcpy. The core then reads the
+ * block through a TapeWindow over the staging buffer.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace tape {
+
+class ReadPrefetch {
+  public:
+    // Staging size: 512 float frames (1024 int16 frames), a 256-sample
+    // block plus the glide of a fast Time knob turn
+    static constexpr size_t BYTES = 4096;
+
+    // Sets up the MDMA channel
+    void Init();
+
+    // Starts copying `bytes` (<= BYTES, a multiple of 4) of tape from `src`
+    // into the staging buffer
+    void Start(const void *src, size_t bytes);
+
+    // Returns once the copy has landed, true if it did. On a failed or
+    // timed out transfer the channel is aborted and the staging buffer is
+    // not to be read.
+    bool Wait();
+
+    const void *Staging() const;
+};
+
+} // namespace tape
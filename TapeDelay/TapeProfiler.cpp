@@ -0,0 +1,82 @@
+#include "TapeProfiler.h"
+
+#include <algorithm>
+
+namespace tape {
+
+namespace {
+
+CpuProfiler::Stats Summarise(const uint32_t *values, size_t n) {
+    uint32_t sorted[CpuProfiler::WINDOW];
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sorted[i] = values[i];
+        sum += values[i];
+    }
+    // p99: the smallest value that 99% of callbacks stay at or below
+    size_t k = (n * 99 + 99) / 100 - 1;
+    std::nth_element(sorted, sorted + k, sorted + n);
+
+    CpuProfiler::Stats st;
+    st.p99 = sorted[k];
+    st.min = *std::min_element(sorted, sorted + n);
+    st.max = *std::max_element(sorted, sorted + n);
+    st.mean = static_cast<uint32_t>(sum / n);
+    return st;
+}
+
+} // namespace
+
+const char *CpuProfiler::StageName(Stage s) {
+    switch (s) {
+        case STAGE_CONTROLS:  return "controls";
+        case STAGE_SAT_WRITE: return "sat+write";
+        case STAGE_TAPE_READ: return "tape read";
+        case STAGE_FILTERS:   return "filters";
+        case STAGE_REVERSE:   return "reverse";
+        case STAGE_MIX:       return "mix";
+        default:              return "?";
+    }
+}
+
+void CpuProfiler::Init(float sample_rate, size_t block_size, float ticks_per_second) {
+    sample_rate_ = sample_rate;
+    ticks_per_second_ = ticks_per_second;
+    EnableCycleCounter();
+    SetBlockSize(block_size);
+    Reset();
+}
+
+void CpuProfiler::SetBlockSize(size_t block_size) {
+    budget_ = static_cast<uint32_t>(ticks_per_second_ * static_cast<float>(block_size) / sample_rate_);
+}
+
+void CpuProfiler::Reset() {
+    fill_ = 0;
+    peak_ = 0;
+    prefetch_fails_ = 0;
+}
+
+bool CpuProfiler::Snapshot(Report &report) const {
+    uint32_t seq = seq_.load(std::memory_order_acquire);
+    if (seq == 0) return false;
+
+    // Copy the finished window; the ISR is filling the other one
+    static Window copy;
+    const Window &src = windows_[published_.load(std::memory_order_relaxed)];
+    copy = src;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_acquire) != seq) return false;
+
+    report.total = Summarise(copy.total, WINDOW);
+    for (int s = 0; s < STAGE_COUNT; s++) report.stage[s] = Summarise(copy.stage[s], WINDOW);
+    report.peak = peak_;
+    report.budget = budget_;
+    report.load_mean = budget_ ? static_cast<float>(report.total.mean) / budget_ : 0.0f;
+    report.load_peak = budget_ ? static_cast<float>(report.peak) / budget_ : 0.0f;
+    report.windows = seq;
+    report.prefetch_fails = prefetch_fails_;
+    return true;
+}
+
+} // namespace tape
@@ -0,0 +1,125 @@
+/**
+ * Per-callback CPU load instrumentation.
+ *
+ * The audio callback brackets itself with BeginCallback() / EndCallback() and
+ * marks stage boundaries with TAPE_PROFILE_MARK(). The ISR side only does a
+ * counter read and a few stores per mark; callbacks are collected into windows
+ * of WINDOW entries, double buffered, and a finished window is handed to the
+ * main loop by bumping a sequence number. Snapshot() copies the finished window
+ * and does the sorting for p99 outside the ISR.
+ *
+ * Per-stage marks are compiled in only with TAPE_PROFILE_STAGES, since on the
+ * per-sample path they cost more than some of the stages they measure.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "TapePlatform.h"
+
+namespace tape {
+
+#ifdef TAPE_PROFILE_STAGES
+#define TAPE_PROFILE_MARK(prof, stage) (prof)->Mark(stage)
+#else
+#define TAPE_PROFILE_MARK(prof, stage) ((void)0)
+#endif
+
+class CpuProfiler {
+  public:
+    enum Stage {
+        STAGE_CONTROLS,   // panel, clock and parameter math
+        STAGE_SAT_WRITE,  // saturation + tape write
+        STAGE_TAPE_READ,  // flutter, delay smoothing + interpolated read
+        STAGE_FILTERS,    // trap filters, DC block, soft limit
+        STAGE_REVERSE,    // reverse feedback filters
+        STAGE_MIX,        // dry/wet mix, LED and gate phase
+        STAGE_COUNT
+    };
+
+    // Callbacks per published window
+    static constexpr size_t WINDOW = 256;
+
+    struct Stats {
+        uint32_t min = 0, mean = 0, max = 0, p99 = 0;
+    };
+
+    struct Report {
+        Stats total;                 // whole callback
+        Stats stage[STAGE_COUNT];    // zero unless built with TAPE_PROFILE_STAGES
+        uint32_t peak = 0;           // worst callback since Init() / Reset()
+        uint32_t budget = 0;         // ticks available per callback
+        float load_mean = 0.0f;      // total.mean / budget
+        float load_peak = 0.0f;      // peak / budget
+        uint32_t windows = 0;        // windows published so far
+        uint32_t prefetch_fails = 0; // staged reads that fell back to SDRAM
+    };
+
+    static const char *StageName(Stage s);
+
+    // `ticks_per_second` is the CPU clock on the hardware, 1e9 on the host.
+    void Init(float sample_rate, size_t block_size, float ticks_per_second);
+    void SetBlockSize(size_t block_size);
+    void Reset();
+
+    // ---- audio callback side ----
+
+    inline void BeginCallback() {
+        start_ = last_ = CycleCount();
+        for (int s = 0; s < STAGE_COUNT; s++) stage_acc_[s] = 0;
+    }
+
+    inline void Mark(Stage s) {
+        uint32_t now = CycleCount();
+        stage_acc_[s] += now - last_;
+        last_ = now;
+    }
+
+    inline void EndCallback() {
+        uint32_t total = CycleCount() - start_;
+        Window &w = windows_[active_];
+        w.total[fill_] = total;
+        for (int s = 0; s < STAGE_COUNT; s++) w.stage[s][fill_] = stage_acc_[s];
+        if (total > peak_) peak_ = total;
+        if (++fill_ == WINDOW) {
+            fill_ = 0;
+            published_.store(active_, std::memory_order_relaxed);
+            seq_.fetch_add(1, std::memory_order_release);
+            active_ ^= 1;
+        }
+    }
+
+    // A staged tape read failed and the block read the tape in place
+    inline void CountPrefetchFail() { prefetch_fails_ = prefetch_fails_ + 1; }
+
+    // ---- main loop side ----
+
+    // Fills `report` from the last finished window. Returns false if no window
+    // has been published yet or the ISR overwrote it while it was being read.
+    bool Snapshot(Report &report) const;
+
+  private:
+    struct Window {
+        uint32_t total[WINDOW];
+        uint32_t stage[STAGE_COUNT][WINDOW];
+    };
+
+    Window windows_[2];
+    uint32_t stage_acc_[STAGE_COUNT] = {};
+    uint32_t start_ = 0, last_ = 0;
+    volatile uint32_t peak_ = 0;
+    volatile uint32_t prefetch_fails_ = 0;
+    size_t fill_ = 0;
+    uint32_t active_ = 0;
+    std::atomic<uint32_t> published_{0};
+    std::atomic<uint32_t> seq_{0};
+
+    float sample_rate_ = 48000.0f;
+    float ticks_per_second_ = 1.0f;
+    uint32_t budget_ = 0;
+};
+
+} // namespace tape
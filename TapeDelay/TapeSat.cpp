@@ -0,0 +1,155 @@
+#include "TapeSat.h"
+
+#include "TapePlatform.h"
+
+namespace tape {
+
+// Active curve plus guard points (see TapeSat.h)
+static float TAPE_DTCM_BSS fatPete[SatTable::SIZE + 3];
+
+float EvalNonlin(int nonlin, float x) {
+    switch (nonlin) {
+        case NONLIN_POLY:      return polysat(x);
+        case NONLIN_CUBIC:     return cnl(x);
+        case NONLIN_PARABOLIC: return parsat(x, 1.0f, 1.0f);
+        default:               return tnhLam(x);
+    }
+}
+
+void SatTable::Init(int nonlin) {
+    if (nonlin < 0 || nonlin >= NONLIN_COUNT) nonlin = NONLIN_TANH;
+    table_ = fatPete + 1;
+    for (size_t i = 0; i < SIZE; i++) {
+        // LUT is around -4..4
+        float v = -RANGE + (2.0f * RANGE) * static_cast<float>(i) / static_cast<float>(SIZE - 1);
+        table_[i] = EvalNonlin(nonlin, v);
+    }
+    table_[-1] = table_[0];
+    table_[SIZE] = table_[SIZE + 1] = table_[SIZE - 1];
+    nonlin_ = nonlin;
+}
+
+// --------------------------------------------------------------------------
+// ENVELOPE
+// --------------------------------------------------------------------------
+
+void SatEnvelope::Init(float sample_rate) {
+    sample_rate_ = sample_rate;
+    env_.Init(sample_rate, 1.0f, STEP);
+    SetParams(0.25f, 0.0f);
+    peak_ = 0.0f;
+    count_ = STEP;
+    from_ = to_ = Target(0.0f);
+}
+
+void SatEnvelope::SetParams(float character, float intensity) {
+    float char2 = character * character;
+    character_ = character;
+    follow_ = intensity < 1.0f;
+
+    // p_Env settings, dynamic depending on 'character'
+    float range = (char2 * 0.876f) + 0.25f;
+    float attack = ((1.0f - character) * 0.3863f) + 0.0157f;
+    float decay = ((1.0f - char2) * 0.5514f) + 0.0236f;
+    range_sq_ = (range + 1.0f) * (range + 1.0f);
+    env_.Set(expA(attack * 7.0f) * 44.1f, expA(decay * 7.0f) * 44.1f);   // ms to samples at 44.1 kHz
+
+    compen_ceiling_ = powf(10.0f, (((1.0f - char2) * 2.0f) + 1.4f) * 0.05f);
+    modcompress_ = (character * 0.28f) + 0.51f;
+
+    // Purify: from 50 % intensity up, crossfade to the static values
+    if (intensity > 0.384615f) {
+        intense_ = (intensity - 0.384615f) * 1.624999f;
+        skew_ = 0.0f;
+    } else {
+        intense_ = 0.0f;
+        skew_ = (char2 * 0.019f) + 0.001f;
+    }
+}
+
+SatEnvelope::Gains SatEnvelope::Target(float env) const {
+    const float c = character_;
+    float agc = (env * 0.719233f) + 0.803526f;                      // approx -2 .. +3.6 dB
+    float compen = 1.0f / (agc < compen_ceiling_ ? agc : compen_ceiling_);
+    compen = compen < 1.0f ? compen : 1.0f;
+    float modifier = ((env * modcompress_) + (1.0f - modcompress_)) + (c * 0.347f);
+
+    // The modifier doubles as a character-scaled drive, compensated after
+    const float intense = intense_;
+    const float doppel = dbtoaA(modifier * (c * 3.0f));
+    return {(agc + (1.001152f - agc) * intense) * doppel,
+            (compen + (0.988553f - compen) * intense) * 0.944061f / doppel,
+            modifier + (0.491438f - modifier) * intense};
+}
+
+SatEnvelope::Gains SatEnvelope::Static() const {
+    const float doppel = dbtoaA(0.491438f * (character_ * 3.0f));
+    return {1.001152f * doppel, 0.988553f * 0.944061f / doppel, 0.491438f};
+}
+
+void SatEnvelope::Process(const float *l, const float *r, float *pre, float *post, float *mod, size_t n) {
+    if (!follow_) {
+        // Full intensity: static gains, the follower keeps its last value
+        // and picks up from them when it runs again
+        const Gains g = Static();
+        for (size_t i = 0; i < n; i++) {
+            pre[i] = g.pre;
+            post[i] = g.post;
+            mod[i] = g.mod;
+        }
+        from_ = to_ = g;
+        count_ = STEP;
+        return;
+    }
+
+    constexpr float k_step = 1.0f / static_cast<float>(STEP);
+    float peak = peak_;
+    for (size_t i = 0; i < n; i++) {
+        const float f = fabsf((l[i] + r[i]) * 0.70710678f);
+        peak = f > peak ? f : peak;
+        if (count_ == STEP) {
+            const float env = env_.Process(fclamp(peak * range_sq_, 0.0f, 1.0f));
+            peak = 0.0f;
+            from_ = to_;
+            to_ = Target(env);
+            count_ = 0;
+        }
+        count_++;
+        const float k = static_cast<float>(count_) * k_step;
+        pre[i] = from_.pre + (to_.pre - from_.pre) * k;
+        post[i] = from_.post + (to_.post - from_.post) * k;
+        mod[i] = from_.mod + (to_.mod - from_.mod) * k;
+    }
+    peak_ = peak;
+}
+
+// --------------------------------------------------------------------------
+// FEEDER EXPANDER
+// --------------------------------------------------------------------------
+
+void FeederExpander::Init(float sample_rate, float attack, float decay) {
+    level_.Init(sample_rate, 1.0f, SatEnvelope::STEP);
+    level_.Set(1.0f / attack, 1.0f / decay);
+    count_ = SatEnvelope::STEP;
+    from_ = to_ = 1.0f;
+}
+
+void FeederExpander::SetTimes(float attack, float decay) {
+    level_.Set(1.0f / attack, 1.0f / decay);
+}
+
+void FeederExpander::Process(const float *in, float *gain, size_t n) {
+    constexpr size_t step = SatEnvelope::STEP;
+    constexpr float k_step = 1.0f / static_cast<float>(step);
+    for (size_t i = 0; i < n; i++) {
+        if (count_ == step) {
+            from_ = to_;
+            to_ = 1.0f - level_.Process(in[i]) * 0.5f;
+            count_ = 0;
+        }
+        count_++;
+        gain[i] = from_ + (to_ - from_) * static_cast<float>(count_) * k_step;
+    }
+}
+
+} // namespace tape
@@ -0,0 +1,199 @@
+/**
+ * Tape saturation: the gen~ `fatPete` lookup table, the realtime sat() curves
+ * and the envelope that drives them.
+ *
+ * gen~ fills a 16384-point table per non-linearity over -4..4 and reads it
+ * with cosine (quality 0) or cubic (quality 1) interpolation, instead of
+ * evaluating the curve per sample. Only the active curve is kept here: it
+ * lives in DTCM (64 KB) and is rebuilt when the non-linearity changes, which
+ * is a settings change and happens outside the audio callback.
+ *
+ * The table has one guard point before and two after the curve so the
+ * interpolators never need a bounds check on their neighbours.
+ *
+ * The gen~ `quality` setting picks how the curve is evaluated (see Quality);
+ * the core dispatches on it once per block, so each level runs as its own
+ * compiled kernel.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "TapeDsp.h"
+#include "TapeParams.h"
+
+namespace tape {
+
+// gen~ `nonlin` selector
+enum Nonlin {
+    NONLIN_TANH,       // tnhLam s-curve (default)
+    NONLIN_POLY,       // polysat
+    NONLIN_CUBIC,      // cnl
+    NONLIN_PARABOLIC,  // parsat(x, 1, 1)
+    NONLIN_COUNT
+};
+
+// gen~ `quality` selector
+enum Quality {
+    QUALITY_LUT_COSINE,  // q0: table, cosine interpolation, static drive (default)
+    QUALITY_LUT_CUBIC,   // q1: table, cubic interpolation, envelope-driven drive
+    QUALITY_REALTIME,    // q2: sat() computed per sample with envelope modifiers
+    QUALITY_COUNT
+};
+
+class SatTable {
+  public:
+    static constexpr size_t SIZE = 16384;
+    static constexpr float RANGE = 4.0f;   // the table spans -RANGE..RANGE
+
+    // Builds the table for `nonlin`; 16k curve evaluations, not for the ISR
+    void Init(int nonlin);
+    void Select(int nonlin) { if (nonlin != nonlin_) Init(nonlin); }
+    int Nonlin() const { return nonlin_; }
+
+    // Curve value at x, cosine interpolated; inputs beyond +-RANGE clamp.
+    // The raised-cosine weight (1 - cos(pi mu)) / 2 is replaced by the
+    // smoothstep mu^2 (3 - 2 mu); with table steps of < 0.0005 the difference
+    // is below 1e-5 of full scale.
+    inline float LookupCosine(float x) const {
+        float pos = fclamp(x * SCALE + OFFSET, 0.0f, static_cast<float>(SIZE - 1));
+        int32_t i = static_cast<int32_t>(pos);
+        float mu = pos - static_cast<float>(i);
+        float a = table_[i];
+        float b = table_[i + 1];
+        return a + (mu * mu * (3.0f - 2.0f * mu)) * (b - a);
+    }
+
+    // Curve value at x, 4-point cubic interpolated (gen~ interp="cubic")
+    inline float LookupCubic(float x) const {
+        float pos = fclamp(x * SCALE + OFFSET, 0.0f, static_cast<float>(SIZE - 1));
+        int32_t i = static_cast<int32_t>(pos);
+        float mu = pos - static_cast<float>(i);
+        const float *p = table_ + i;
+        float a0 = p[2] - p[1] - p[-1] + p[0];
+        float a1 = p[-1] - p[0] - a0;
+        float a2 = p[1] - p[-1];
+        return ((a0 * mu + a1) * mu + a2) * mu + p[0];
+    }
+
+  private:
+    static constexpr float SCALE = (SIZE - 1) / (2.0f * RANGE);
+    static constexpr float OFFSET = (SIZE - 1) * 0.5f;
+
+    float *table_ = nullptr;
+    int nonlin_ = -1;
+};
+
+// Curve evaluated directly, the reference for the table
+float EvalNonlin(int nonlin, float x);
+
+// --------------------------------------------------------------------------
+// REALTIME CURVES (quality 2)
+// --------------------------------------------------------------------------
+
+// gen~ sat() before its dcblock(); `mod` is the envelope modifier, used by
+// the tanh and parabolic curves only
+template <int NL>
+inline float SatRealtime(float x, float mod) {
+    if constexpr (NL == NONLIN_POLY) {
+        return polysat(x);
+    } else if constexpr (NL == NONLIN_CUBIC) {
+        return cnl(x);
+    } else if constexpr (NL == NONLIN_PARABOLIC) {
+        return parsat(x, 1.0f, parsatMod(mod));
+    } else {
+        return tnhb(x, tnhbMod(mod));
+    }
+}
+
+// Gain after sat()'s dcblock(): tanh and polysat need attenuation for +15 dB
+template <int NL>
+constexpr float SatRealtimeGain() {
+    return NL == NONLIN_POLY ? 0.976322f : (NL == NONLIN_TANH ? 0.976047f : 1.0f);
+}
+
+// --------------------------------------------------------------------------
+// ENVELOPE (quality 1 and 2)
+// --------------------------------------------------------------------------
+
+// gen~ ENVELOPE + PURIFY stages: a VU-style follower (p_Env) on the dry input
+// sets the saturator's input gain, output compensation and curve modifier.
+// The follower steps once every STEP samples on the peak since its last step,
+// and the gains are interpolated per sample in between. Above 50 % intensity
+// the result crossfades to the static values, and at full intensity the
+// follower is not run at all.
+class SatEnvelope {
+  public:
+    // Samples per follower step
+    static constexpr size_t STEP = 8;
+
+    void Init(float sample_rate);
+
+    // Per block. `character` 0..1 (gen~ default 0.25); `intensity` is the
+    // Feedback knob 0..1.
+    void SetParams(float character, float intensity);
+
+    // Follows (l + r) / sqrt 2 over n samples and writes the saturator's
+    // input gain (`pre`), output gain (`post`) and curve modifier (`mod`).
+    void Process(const float *l, const float *r, float *pre, float *post, float *mod, size_t n);
+
+    // Modifier offset for the right channel (gen~ `S`)
+    float Skew() const { return skew_; }
+
+    // fixdenorm on the follower, once per block
+    void Flush() {
+        env_.Flush();
+        peak_ = fixdenorm(peak_);
+    }
+
+  private:
+    struct Gains {
+        float pre, post, mod;
+    };
+    Gains Target(float env) const;
+    Gains Static() const;
+
+    float sample_rate_ = 48000.0f;
+    Smoother<SlideLite> env_;   // p_SlideLite, one step per STEP samples
+
+    // Peak of the input since the last step, samples since it, and the
+    // gains being interpolated between
+    float peak_ = 0.0f;
+    size_t count_ = STEP;
+    Gains from_ = {1.0f, 1.0f, 0.0f}, to_ = {1.0f, 1.0f, 0.0f};
+
+    // Derived in SetParams()
+    bool follow_ = true;
+    float character_ = 0.25f;
+    float range_sq_ = 1.0f;
+    float compen_ceiling_ = 1.0f;
+    float modcompress_ = 0.5f;
+    float intense_ = 0.0f;
+    float skew_ = 0.0f;
+};
+
+// gen~ feederCompression: scales a head's filtered output down as the dry
+// input rises (by at most half). An asymmetric slew (attack, decay: the
+// gen~ per-sample amounts at 44.1 kHz) follows the signed input, so the faster the attack is against
+// the decay, the more it acts like a peak follower. Stepped every
+// SatEnvelope::STEP samples and interpolated, like the envelope.
+class FeederExpander {
+  public:
+    void Init(float sample_rate, float attack, float decay);
+    // New attack and decay, keeping the level where it is
+    void SetTimes(float attack, float decay);
+    // fixdenorm on the follower, once per block
+    void Flush() { level_.Flush(); }
+
+    // Output gains for the n input samples
+    void Process(const float *in, float *gain, size_t n);
+
+  private:
+    Smoother<SlideLite> level_;
+    size_t count_ = SatEnvelope::STEP;
+    float from_ = 1.0f, to_ = 1.0f;
+};
+
+} // namespace tape
@@ -0,0 +1,113 @@
+#include "TapeTrap.h"
+
+namespace tape {
+
+void TrapDesign::Init(float sample_rate, float character) {
+    sample_rate_ = sample_rate;
+    character_ = character;
+    lp.Init(sample_rate, 18000.0f);
+    hp.Init(sample_rate, 147.0f);
+    // gen~ smooths freqmult, rmul and rm0 with smpsmooth; they all follow
+    // the intensity, so it glides that instead
+    tone_.Init(sample_rate, 0.9995f);
+    intensity_.Init(sample_rate, 0.9995f);
+    tone_target_ = 18000.0f;
+    intensity_target_ = 0.0f;
+    Reset();
+}
+
+void TrapDesign::SetTopology(int topology) {
+    topology_ = (topology >= 0 && topology < TOPOLOGY_COUNT) ? topology : TOPOLOGY_201;
+    dirty_ = true;
+}
+
+void TrapDesign::Reset() {
+    tone_.Reset(tone_target_);
+    intensity_.Reset(intensity_target_);
+    dirty_ = true;
+}
+
+void TrapDesign::Update(size_t n) {
+    lp.Update(n);
+    if (topology_ == TOPOLOGY_201) return;
+    const bool moved = tone_.Value() != tone_target_ || intensity_.Value() != intensity_target_;
+    if (moved) {
+        tone_.Advance(tone_target_, n, 0.5f);
+        intensity_.Advance(intensity_target_, n);
+    }
+    if (moved || dirty_) {
+        Compute();
+        dirty_ = false;
+    }
+}
+
+float TrapDesign::FeederAttack(size_t lane) const {
+    // gen~ hat1 / hat2, skewed between the sides on purpose
+    switch (topology_) {
+        case TOPOLOGY_LOFI: return 0.0001f;
+        case TOPOLOGY_OLD:  return 0.002f;
+        case TOPOLOGY_DARK: return lane == 0 ? 0.003f : 0.002f;
+        default:            return lane == 0 ? 0.001f : 0.0002f;
+    }
+}
+
+void TrapDesign::Compute() {
+    const float sr = sample_rate_;
+    const float is = intensity_.Value();
+    const float is2 = is * is;
+    // Resonance modifiers, tuned by ear in gen~
+    const float resmod0 = ((character_ * character_ * 0.08736f) + is2) + 0.01f;
+    const float resmod1 = character_ + 0.01f;
+    const float rmul = ((is * resmod1) * 0.99f) + 0.01f;
+    const float rm0 = (fmaxf(resmod0, 0.0f) * 0.45264f) + 0.04f;
+    const float rm105 = resmod1 * 0.666667f;
+    const float rm1025 = rm105 * 0.666667f;
+    const float rm01 = rm0 + rm105;
+    // 0.25 at 400 Hz .. 2 at 18 kHz, log in between like the knob
+    const float tone = 0.25f * powf(tone_.Value() / 400.0f, 0.546334f);
+
+    switch (topology_) {
+        case TOPOLOGY_LOFI: {
+            const float freqmult = (is * -0.06f) + 0.72f;
+            lofiLp.Set(2240.0f * freqmult * tone, sr);
+            lofiHp[0].Set(35.0f * rmul, rm0 * rmul, sr);
+            lofiHp[1].Set(36.0f * rmul, rm0 * rmul, sr);
+            break;
+        }
+        case TOPOLOGY_OLD: {
+            const float freqmult = (((fclamp(is2, 0.5f, 1.0f) * 2.0f) - 1.0f) * -0.07f) + 1.0f;
+            const float rmod = rm0 * ((is2 * -0.875f) + 1.0f);
+            const float rmd = fminf((rm01 * ((is2 * -0.875f) + 1.0f)) + rm1025, 0.97f);
+            oldLp.Set(3699.0f * freqmult * tone, rmod, sr);
+            oldHp.f = OnePoleCoeff::Compute(214.0f * rmd, sr);
+            break;
+        }
+        case TOPOLOGY_DARK: {
+            const float freqmult = is + 1.0f;
+            const float rmod = rm0 * (1.0f - (is2 * 0.5f));
+            const float rmd = ((fminf(rm01 * (1.0f - (is2 * 0.5f)), 0.97f) * rmul) * is2) * 0.808f;
+            darkLp.Set(3699.0f * freqmult * tone, rmod, sr);
+            darkHp[0].Set(145.0f * rmul, fmaxf(rmd, 0.11f), sr);
+            darkHp[1].Set(148.0f * rmul, fmaxf(rmd, 0.11f), sr);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void TrapFilter::Init(float sample_rate) {
+    lp_.Init(sample_rate);
+    hp_.Init(sample_rate);
+    Reset();
+}
+
+void TrapFilter::Reset() {
+    lp_.y0 = hp_.y0 = 0.0f;
+    poleZero_ = PoleZeroLP();
+    lores_ = LoresHipass();
+    lpSk_ = SallenKey();
+    hpSk_ = SallenKey();
+}
+
+} // namespace tape
@@ -0,0 +1,154 @@
+/**
+ * Trap filters: the filter chain on the tape output, before the DC block
+ * and soft limit (gen~ `topology`). Every topology is a lowpass followed by
+ * a highpass:
+ *
+ *   201   6 dB one-pole lowpass (Tone knob), 6 dB one-pole "wrong" highpass
+ *         at 147 Hz (the original default)
+ *   LoFi  6 dB pole / zero lowpass, resonant lores~ flipped into a dirty
+ *         highpass
+ *   Old   12 dB Sallen & Key lowpass, one-pole highpass
+ *   Dark  12 dB Sallen & Key lowpass and highpass, then simpSat, so the
+ *         feedback is always heavy
+ *
+ * Each topology is its own kernel, picked once per block. The gen~ patch
+ * recomputes sin / cos / tnA coefficients every sample; TrapDesign only
+ * recomputes those of the active topology, and only while the cutoff or
+ * resonance moves.
+ *
+ * Outside 201 the cutoffs and resonances follow the feedback intensity and
+ * `character` as in gen~, and the Tone knob scales the lowpass cutoff by
+ * 0.25..2 across its travel (the range of gen~ `freqatten`, which only
+ * reaches 201 there).
+ */
+
+#pragma once
+
+#include <type_traits>
+
+#include "TapeDsp.h"
+#include "TapeParams.h"
+
+namespace tape {
+
+// gen~ `topology` selector
+enum Topology {
+    TOPOLOGY_201,   // one-pole chain (default)
+    TOPOLOGY_LOFI,  // pole / zero lowpass, lores highpass
+    TOPOLOGY_OLD,   // Sallen & Key lowpass, one-pole highpass
+    TOPOLOGY_DARK,  // Sallen & Key lowpass and highpass, simpSat
+    TOPOLOGY_COUNT
+};
+
+// Coefficients of the active topology, shared by both channels (the
+// highpasses of LoFi and Dark are tuned slightly apart per side)
+class TrapDesign {
+  public:
+    void Init(float sample_rate, float character);
+
+    void SetTopology(int topology);
+    int Topology() const { return topology_; }
+
+    // Tone lowpass cutoff in Hz, 400..18000 over the knob's travel, and the
+    // feedback intensity 0..1
+    void SetTone(float cutoff) { lp.SetCutoff(cutoff); tone_target_ = cutoff; }
+    void SetIntensity(float intensity) { intensity_target_ = intensity; }
+    // Jump straight to the tone and intensity set (the first callback)
+    void Reset();
+
+    // Call once per block of n samples: glides the tone and intensity and
+    // recomputes the active topology's coefficients if they moved
+    void Update(size_t n);
+
+    // gen~ feederCompression attack for each side under this topology
+    float FeederAttack(size_t lane) const;
+
+    // 201: tone lowpass and the fixed 147 Hz highpass; the reverse feedback
+    // path uses these whatever the topology (gen~ routing)
+    OnePoleCoeff lp, hp;
+    // LoFi
+    PoleZeroCoeff lofiLp;
+    LoresCoeff lofiHp[2];
+    // Old
+    SallenKeyCoeff oldLp;
+    OnePoleCoeff oldHp;
+    // Dark
+    SallenKeyCoeff darkLp;
+    SallenKeyCoeff darkHp[2];
+
+  private:
+    void Compute();
+
+    float sample_rate_ = 48000.0f;
+    float character_ = 0.25f;
+    int topology_ = TOPOLOGY_201;
+    float tone_target_ = 1000.0f, intensity_target_ = 0.0f;
+    Smoother<SmpSmooth> tone_, intensity_;
+    bool dirty_ = true;
+};
+
+// One channel's filter state for every topology
+class TrapFilter {
+  public:
+    void Init(float sample_rate);
+    // Clears the state (on a topology change)
+    void Reset();
+    // fixdenorm on the state, once per block
+    void Flush() {
+        lp_.Flush();
+        hp_.Flush();
+        poleZero_.Flush();
+        lores_.Flush();
+        lpSk_.Flush();
+        hpSk_.Flush();
+    }
+
+    // Kernel for topology T: n samples from `src` into `out` (may alias)
+    template <int T>
+    void Process(const float *src, float *out, size_t n, const TrapDesign &d, size_t lane);
+
+    // One sample of the same
+    template <int T>
+    inline float Sample(float x, const TrapDesign &d, size_t lane) {
+        if constexpr (T == TOPOLOGY_LOFI) {
+            return lores_.Process(poleZero_.Process(x, d.lofiLp), d.lofiHp[lane]);
+        } else if constexpr (T == TOPOLOGY_OLD) {
+            return hp_.Process(lpSk_.Process<0>(x, d.oldLp) * 0.922571f, d.oldHp, 1);
+        } else if constexpr (T == TOPOLOGY_DARK) {
+            const float s = hpSk_.Process<1>(lpSk_.Process<0>(x, d.darkLp) * 0.822243f, d.darkHp[lane]);
+            return simpSat(s * 0.822243f) * 0.906776f;
+        } else {
+            return hp_.Process(lp_.Process(x, d.lp, 0), d.hp, 1);
+        }
+    }
+
+  private:
+    OnePole6dB lp_, hp_;
+    PoleZeroLP poleZero_;
+    LoresHipass lores_;
+    SallenKey lpSk_, hpSk_;
+};
+
+template <int T>
+void TrapFilter::Process(const float *src, float *out, size_t n, const TrapDesign &d, size_t lane) {
+    if constexpr (T == TOPOLOGY_201) {
+        lp_.ProcessBlock(src, out, n, d.lp, 0);
+        hp_.ProcessBlock(out, out, n, d.hp, 1);
+    } else {
+        for (size_t i = 0; i < n; i++) out[i] = Sample<T>(src[i], d, lane);
+    }
+}
+
+// Runs f(integral_constant<T>) for the topology
+template <typename F>
+inline void DispatchTopology(int topology, F &&f) {
+    using std::integral_constant;
+    switch (topology) {
+        case TOPOLOGY_LOFI: f(integral_constant<int, TOPOLOGY_LOFI>()); break;
+        case TOPOLOGY_OLD:  f(integral_constant<int, TOPOLOGY_OLD>()); break;
+        case TOPOLOGY_DARK: f(integral_constant<int, TOPOLOGY_DARK>()); break;
+        default:            f(integral_constant<int, TOPOLOGY_201>()); break;
+    }
+}
+
+} // namespace tape
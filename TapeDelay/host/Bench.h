@@ -0,0 +1,78 @@
+/**
+ * Timing helpers for the host benchmarks.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace host {
+
+// Deterministic white noise in -amp..amp
+inline std::vector<float> UniformNoise(size_t n, float amp, uint32_t seed) {
+    std::vector<float> v(n);
+    uint32_t x = seed ? seed : 1;
+    for (size_t i = 0; i < n; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        v[i] = amp * (static_cast<float>(x) * (2.0f / 4294967296.0f) - 1.0f);
+    }
+    return v;
+}
+
+// Program-like drive signal: a sine gliding from 50 Hz to 5 kHz at 48 kHz,
+// so table lookups have the locality real audio gives them
+inline std::vector<float> SineSweep(size_t n, float amp) {
+    std::vector<float> v(n);
+    double phase = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double hz = 50.0 * pow(100.0, static_cast<double>(i) / n);
+        phase += hz / 48000.0;
+        v[i] = amp * static_cast<float>(sin(6.283185307179586 * phase));
+    }
+    return v;
+}
+
+// Keeps results alive so the compiler cannot drop the work being timed
+__attribute__((noinline)) inline void Consume(const float *v, size_t n) {
+    static volatile float sink;
+    sink = n ? v[n / 2] : 0.0f;
+    (void)sink;
+}
+
+// Best-of-`runs` nanoseconds per call of f(x) over `input`
+template <typename F>
+double NsPerSample(const std::vector<float> &input, F f, int runs = 7) {
+    using clock = std::chrono::steady_clock;
+    std::vector<float> out(input.size());
+    double best = 1e30;
+    for (int r = 0; r < runs; r++) {
+        auto t0 = clock::now();
+        for (size_t i = 0; i < input.size(); i++) out[i] = f(input[i]);
+        auto t1 = clock::now();
+        Consume(out.data(), out.size());
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / input.size();
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+// Best-of-`runs` nanoseconds per sample of a block process(n) call that
+// handles `samples` samples in total
+template <typename F>
+double NsPerBlock(size_t samples, F process, int runs = 7) {
+    using clock = std::chrono::steady_clock;
+    double best = 1e30;
+    for (int r = 0; r < runs; r++) {
+        auto t0 = clock::now();
+        process();
+        auto t1 = clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+} // namespace host
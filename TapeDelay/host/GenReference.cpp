@@ -0,0 +1,873 @@
+#include "GenReference.h"
+
+#include <cmath>
+
+namespace host {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double TWOPI = 2.0 * PI;
+constexpr double SQRT1_2 = 0.70710678118654752440;
+constexpr size_t FATSO = 16384;
+
+// --------------------------------------------------------------------------
+// GENLIB OPERATORS
+// --------------------------------------------------------------------------
+
+inline double Clip(double x, double lo, double hi) { return x > hi ? hi : (x < lo ? lo : x); }
+inline double Mix(double a, double b, double t) { return a + t * (b - a); }
+inline double SafeDiv(double a, double b) { return b == 0.0 ? 0.0 : a / b; }
+inline double DbToA(double db) { return std::pow(10.0, db * 0.05); }
+inline double FixDenorm(double x) { return std::fpclassify(x) == FP_SUBNORMAL ? 0.0 : x; }
+
+inline double Wrap(double v, double lo, double hi) {
+    const double range = hi - lo;
+    if (v >= lo && v < hi) return v;
+    if (range <= 0.000000001) return lo;
+    const long wraps = static_cast<long>((v - lo) / range) - (v < lo);
+    return v - range * static_cast<double>(wraps);
+}
+
+inline double Scale(double in, double inlo, double inhi, double outlo, double outhi, double power) {
+    double v = (in - inlo) * SafeDiv(1.0, inhi - inlo);
+    if (v > 0.0) v = std::pow(v, power);
+    else if (v < 0.0) v = -std::pow(-v, power);
+    return v * (outhi - outlo) + outlo;
+}
+
+inline double Triangle(double phase) {
+    phase = Wrap(phase, 0.0, 1.0);
+    return phase < 0.5 ? phase / 0.5 : 1.0 - (phase - 0.5) / 0.5;
+}
+
+inline double CosineInterp(double a, double x, double y) {
+    return Mix(x, y, (1.0 - std::cos(a * PI)) * 0.5);
+}
+
+inline double CubicInterp(double a, double w, double x, double y, double z) {
+    const double a2 = a * a;
+    const double f0 = z - y - w + x;
+    const double f1 = w - x - f0;
+    const double f2 = y - w;
+    return f0 * a * a2 + f1 * a2 + f2 * a + x;
+}
+
+// --------------------------------------------------------------------------
+// PATCH FUNCTIONS
+// --------------------------------------------------------------------------
+
+double expA(double x) {
+    x = x * 2.0;
+    x = 0.999996 + (0.031261316 + (0.00048274797 + 0.000006 * x) * x) * x;
+    x *= x; x *= x; x *= x; x *= x;
+    return x * x;
+}
+
+double tnA(double x) {
+    const double x2 = x * x;
+    const double x3 = x2 * x;
+    const double x5 = x2 * x3;
+    return ((x5 * 0.133333) + (x3 * 0.333333)) + x;
+}
+
+double cosApp01(double a) {
+    const double p = Wrap(a, 0.0, 1.0) - 0.75;
+    const double pa = std::fabs(p);
+    const double cl = ((pa - 0.5) * (pa - 0.924933)) * (pa + 0.424933);
+    const double cr = (((pa + 1.05802) * pa) + 0.436501) * ((pa * (pa - 2.05802)) + 1.21551);
+    return p * ((cl * cr) * 60.252201);
+}
+
+double sinApp01(double a) { return cosApp01(a - 0.25); }
+
+double tnhLam(double x) {
+    const double x2 = x * x;
+    const double a = (((x2 + 378) * x2 + 17325) * x2 + 135135) * x;
+    const double b = ((28 * x2 + 3150) * x2 + 62370) * x2 + 135135;
+    return Clip(SafeDiv(a, b), -1.0, 1.0);
+}
+
+double tnhb(double x, double m) {
+    const double exb = std::exp(m * x);
+    return SafeDiv(2.0, 1.0 + exb) - 1.0;
+}
+
+double polysat(double x) {
+    const double x2 = x * x;
+    const double x3 = x * x2;
+    const double p531 = (x + (x3 * -0.18963)) + ((x3 * x2) * 0.016182);
+    const double pn = -1.875 > x ? -1.0 : p531;
+    const double y = x > 1.875 ? 1.0 : pn;
+    return y * 0.999995;
+}
+
+double cnl(double x) {
+    x = Clip(x, -1.0, 1.0);
+    return x * (1.0 - 0.333333 * x * x);
+}
+
+double parsat(double x0, double a0, double c1) {
+    const double x1 = Clip(x0, -1.0, 1.0);
+    const double c2 = c1 + c1;
+    const double x2 = Clip(x1 * a0, c2 * -1.0, c2);
+    return x2 * (1.0 - (std::fabs(x2) * SafeDiv(0.25, c1)));
+}
+
+double tnhbMod(double mod) {
+    return Scale(std::fmin(mod, 1.0), 1.0, 0.0, -5.067268, -1.098611, 0.38103);
+}
+
+double parsatMap(double ind) {
+    if (ind == 1.0) return 0.6;
+    if (ind == 2.0) return 1.5;
+    return 0.5;
+}
+
+double parsatMod(double mod) {
+    const double feeder = mod * 2.0;
+    const double ate = std::trunc(feeder);
+    const double ion = feeder - ate;
+    return CosineInterp(ion, parsatMap(ate), parsatMap(ate + 1.0));
+}
+
+double simpSat(double xin) {
+    const double x = Clip(xin, -1.0, 1.0);
+    return 0.5 * x * (3.0 - (x * x));
+}
+
+double softStatic(double x) {
+    if (x > 1.0) return (1.0 - SafeDiv(4.0, x + 3.0)) * 4.0 + 1.0;
+    if (x < -1.0) return (1.0 + SafeDiv(4.0, x - 3.0)) * -4.0 - 1.0;
+    return x;
+}
+
+double hTrap(double ph, double lo, double hi, double up, double down) {
+    const double phw = Wrap(ph, 0.0, 1.0);
+    const double ucl = Clip(up, 0.0, 1.0);
+    const double dcl = Clip(down, ucl, 1.0);
+    const double hml = hi - lo;
+    const double ds = lo + (hml * (1.0 - SafeDiv(phw - dcl, 1.0 - dcl)));
+    const double us = lo + (hml * SafeDiv(phw, ucl));
+    const double r1 = phw > dcl ? ds : hi;
+    return phw < ucl ? us : r1;
+}
+
+double plus2A(double a, double b) { return (a + b) * 0.6; }
+double plus2B(double a, double b) { return (a + b) * 0.4; }
+double plus2C(double a, double b) { return (a * 0.435) + (b * 0.665); }
+double plus2D(double a, double b) { return (a + b) * 0.55; }
+
+double hscale(int typ, double hld) {
+    if (!(hld > 0.0)) return 1.0;
+    switch (typ) {
+        case 1: return 0.833333;
+        case 2: return 1.25;
+        case 3: return 0.909091;
+        default: return 1.0;
+    }
+}
+
+} // namespace
+
+GenParams GenParams::Clamped() const {
+    GenParams p = *this;
+    p.intensity = Clip(intensity, 0.0, 1.0);
+    p.character = Clip(character, 0.0, 1.0);
+    p.direction = Clip(direction, 0.0, 1.0);
+    p.hysterisis = Clip(hysterisis, 0.000001, 0.71);
+    p.quality = Clip(quality, 0.0, 2.0);
+    p.nonlin = Clip(nonlin, 0.0, 3.0);
+    p.holdatten = Clip(holdatten, 0.994, 1.0);
+    p.wow = Clip(wow, 0.0, 1.0);
+    p.reversestyle = Clip(reversestyle, 0.0, 1.0);
+    p.rvrbRoute = Clip(rvrbRoute, 0.0, 2.0);
+    p.topology = Clip(topology, 0.0, 3.0);
+    p.freqatten = Clip(freqatten, 0.25, 2.0);
+    p.InitialDelay = Clip(InitialDelay, 10.0, 1000.0);
+    p.Mode = Clip(Mode, 1.0, 12.0);
+    p.Hold = Clip(Hold, 0.0, 1.0);
+    p.MUTE = Clip(MUTE, 0.0, 1.0);
+    return p;
+}
+
+namespace gen {
+
+// --------------------------------------------------------------------------
+// STATEFUL OPERATORS
+// --------------------------------------------------------------------------
+
+void DelayLine::Init(size_t size) {
+    size_t len = 1;
+    while (len < size + 4) len <<= 1;
+    mem_.assign(len, 0.0);
+    mask_ = len - 1;
+    write_ = 0;
+    size_ = static_cast<double>(size);
+}
+
+double DelayLine::ReadLinear(double d) const {
+    const double r = static_cast<double>(write_ + mem_.size()) - Clip(d, 1.0, size_);
+    const long r1 = static_cast<long>(r);
+    const double a = r - static_cast<double>(r1);
+    return Mix(mem_[r1 & mask_], mem_[(r1 + 1) & mask_], a);
+}
+
+double DelayLine::ReadCubic(double d) const {
+    const double r = static_cast<double>(write_ + mem_.size()) - Clip(d, 1.0, size_);
+    const long r1 = static_cast<long>(r);
+    const double a = r - static_cast<double>(r1);
+    return CubicInterp(a, mem_[(r1 - 1) & mask_], mem_[r1 & mask_], mem_[(r1 + 1) & mask_],
+                       mem_[(r1 + 2) & mask_]);
+}
+
+void DelayLine::Write(double x) {
+    mem_[write_] = x;
+    write_ = (write_ + 1) & mask_;
+}
+
+double Counter::operator()(double incr, double max, bool &carry) {
+    count = FixDenorm(count + incr);
+    carry = false;
+    if (max > 0.0 && count >= max) {
+        const long wraps = static_cast<long>(count / max);
+        count -= static_cast<double>(wraps) * max;
+        carry = true;
+    }
+    return count;
+}
+
+double Slide::operator()(double x, double up, double down) {
+    const double s = x - current;
+    const double us = s * (1.0 / std::fmax(std::fabs(up), 1.0));
+    const double ds = s * (1.0 / std::fmax(std::fabs(down), 1.0));
+    current = current + ((x > current) ? us : ds);
+    return current;
+}
+
+double AllPole6::operator()(int type, double x, double cutoff, double sr) {
+    const double f = Clip(std::sin(cutoff * TWOPI / sr), 0.00001, 0.99999);
+    const double lp = Mix(y0, x, f);
+    y0 = lp;
+    return type == 1 ? lp - x : lp;   // the intentionally 'wrong' highpass
+}
+
+double PoleZero::operator()(int type, double x, double cutoff, double sr) {
+    const double fc = (PI * std::fmax(std::fmin(cutoff, sr * 0.5), 1.0)) / sr;
+    const double a0 = std::fmin(SafeDiv(2.0 * std::sin(fc), std::cos(fc) + std::sin(fc)), 0.999999);
+    const double a1 = 1.0 - (a0 * 2.0);
+    const double w = x * a0;
+    const double lp = r + w;
+    r = w + (lp * a1);
+    return type == 1 ? x - lp : lp;
+}
+
+double SallenKey::operator()(int type, double v0, double cutoff, double res, double sr) {
+    const double g = tnA(PI * (cutoff / sr));
+    const double k = 2.0 * res;
+    const double gp1 = 1.0 + g;
+    const double a0 = SafeDiv(1.0, (gp1 * gp1) - (g * k));
+    const double a1 = k * a0;
+    const double a2 = gp1 * a0;
+    const double a3 = g * a2;
+    const double a4 = SafeDiv(1.0, gp1);
+    const double a5 = g * a4;
+    const double v1 = (a1 * ic2eq) + (a2 * ic1eq) + (a3 * v0);
+    const double v2 = (a4 * ic2eq) + (a5 * v1);
+    ic1eq = (2.0 * (v1 - (k * v2))) - ic1eq;
+    ic2eq = (2.0 * v2) - ic2eq;
+    if (type == 1) return v0 - v2;
+    if (type == 2) return v1 - v2;
+    return v2;
+}
+
+double Lores::operator()(double x, double cf, double q, double sr) {
+    const double frad = std::cos(cf * TWOPI / sr);
+    const double res = 0.882497 * std::exp(q * 0.125);
+    const double scl = (frad * res) * -2.0;
+    const double r2 = res * res;
+    const double scin = x * ((scl + r2) + 1.0);
+    const double oput = scin - ((scl * ya) + (r2 * yb));
+    yb = ya;
+    ya = oput;
+    return x - oput;
+}
+
+double Feeder::operator()(double x, double h0, double h1) {
+    const double c = x - curr;
+    const double s = (x > curr) ? (c * h0) : (c * h1);
+    const double b = FixDenorm(curr + s);
+    curr = b;
+    return 1.0 - (b * 0.5);
+}
+
+} // namespace gen
+
+// --------------------------------------------------------------------------
+// GENREFERENCE
+// --------------------------------------------------------------------------
+
+void GenReference::Init(double sample_rate, double tape_seconds, bool settled) {
+    *this = GenReference();
+    sample_rate_ = sample_rate;
+    jump_ = settled;
+
+    // Buffer Tape: an even number of frames, so both halves are equal
+    tdim_ = static_cast<size_t>(tape_seconds * sample_rate * 0.5) * 2;
+    for (auto &t : tape_) t.assign(tdim_, 0.0f);
+
+    // initlut: the fatPete tables over -4..4
+    for (auto &t : fatPete_) t.resize(FATSO);
+    for (size_t i = 0; i < FATSO; i++) {
+        const double v = Scale(static_cast<double>(i), 0.0, FATSO - 1.0, -4.0, 4.0, 1.0);
+        fatPete_[0][i] = tnhLam(v);
+        fatPete_[1][i] = polysat(v);
+        fatPete_[2][i] = cnl(v);
+        fatPete_[3][i] = parsat(v, 1.0, 1.0);
+    }
+
+    for (auto &m : munge_) m.Init(909);
+    const size_t heads = static_cast<size_t>(sample_rate);
+    head2L_.Init(heads);
+    head2R_.Init(heads);
+    head3L_.Init(heads);
+    head3R_.Init(heads);
+
+    // sah(Hold, syncHoldMaster, 0.5, init=1) and the reverse loop's sah()s
+    holdSah_ = {1.0, 1.0};
+    revLoopSah_ = {1.0, 1.0};
+    revPhaseSah_ = {1.0, 1.0};
+}
+
+void GenReference::Process(const GenParams &params, const float *inL, const float *inR, const float *noise,
+                           float *outL, float *outR, size_t n) {
+    const GenParams p = params.Clamped();
+    double out[5];
+    for (size_t i = 0; i < n; i++) {
+        Tick(p, inL[i], inR[i], noise ? noise[i] : 0.0, out);
+        outL[i] = static_cast<float>(out[0]);
+        outR[i] = static_cast<float>(out[1]);
+    }
+    meters_[0] = out[2];
+    meters_[1] = out[3];
+    meters_[2] = out[4];
+}
+
+double GenReference::SmpSmooth(double &h, double v, double s) {
+    if (jump_) h = v;
+    h = Mix(v, h, s);
+    return h;
+}
+
+double GenReference::Cpsm(double &h, double a, double f) {
+    if (jump_) h = a;
+    const double x = (1.0 - f) * (44100.0 / sample_rate_);
+    h = ((a - h) * x) + h;
+    return h;
+}
+
+double GenReference::RSmooth(double &h, double x, double s) {
+    if (jump_) h = x;
+    const double ad = SafeDiv(0.693147, s * sample_rate_);
+    h = ((x - h) * ad) + h;
+    return h;
+}
+
+void GenReference::Env(double x, double r, double a, double d, double m, bool t, double &env1, double &env2) {
+    const double r1 = r + 1.0;
+    const double f = Clip(std::fabs(x) * (r1 * r1), 0.0, 1.0);
+    const double au = MsToSamps(expA(a * 7.0));
+    const double dd = MsToSamps(expA(d * 7.0));
+    env1 = envSlide1_(f, au, dd);
+    if (t) {
+        const double dm = dd * (expA(m * 5.0) + 2.0);
+        env2 = envSlide2_(f, au, dm);
+    } else {
+        env2 = 0.0;
+    }
+}
+
+double GenReference::Sat(int nl, double x, double mod, gen::DcBlock &dc) const {
+    double dcba, y;
+    if (nl == 1) {
+        dcba = 0.976322;
+        y = polysat(x);
+    } else if (nl == 2) {
+        dcba = 1.0;
+        y = cnl(x);
+    } else if (nl == 3) {
+        dcba = 1.0;
+        y = parsat(x, 1.0, parsatMod(mod));
+    } else {
+        dcba = 0.976047;
+        y = tnhb(x, tnhbMod(mod));
+    }
+    return dc(y) * dcba;
+}
+
+double GenReference::Lookup(double x, int nl, bool cubic) const {
+    const std::vector<double> &t = fatPete_[nl < 0 ? 0 : (nl > 3 ? 3 : nl)];
+    const long last = static_cast<long>(FATSO) - 1;
+    const double phase = (x + 1.0) * 0.5 * static_cast<double>(last);
+    const long i = static_cast<long>(std::floor(phase));
+    const double a = phase - static_cast<double>(i);
+    auto at = [&](long j) { return t[static_cast<size_t>(j < 0 ? 0 : (j > last ? last : j))]; };
+    if (cubic) return CubicInterp(a, at(i - 1), at(i), at(i + 1), at(i + 2));
+    return CosineInterp(a, at(i), at(i + 1));
+}
+
+double GenReference::SampleTape(double pos, int ch, bool cubic) const {
+    const std::vector<float> &t = tape_[ch];
+    const long dim = static_cast<long>(tdim_);
+    const long i = static_cast<long>(std::floor(pos));
+    const double a = pos - static_cast<double>(i);
+    auto at = [&](long j) {
+        j %= dim;
+        return static_cast<double>(t[static_cast<size_t>(j < 0 ? j + dim : j)]);
+    };
+    if (cubic) return CubicInterp(a, at(i - 1), at(i), at(i + 1), at(i + 2));
+    return CosineInterp(a, at(i), at(i + 1));
+}
+
+// The GenExpr main body, stage by stage; names follow the patch
+void GenReference::Tick(const GenParams &p, double in1, double in2, double in3, double *out) {
+    const double sr = sample_rate_;
+    const int M = static_cast<int>(p.MUTE);
+
+    if (jump_) holdSah_.out = p.Hold;
+    const double H = holdSah_(p.Hold, syncHoldMaster_, 0.5);
+
+    const int dir = static_cast<int>(p.direction);
+    const int q = static_cast<int>(p.quality);
+    const int nl = static_cast<int>(p.nonlin);
+    const bool cw = nl > 1;
+    const bool ew = p.wow > 0.5;
+    const int revstyle = static_cast<int>(p.reversestyle);
+    const int rvRo = static_cast<int>(p.rvrbRoute);
+    const int tplgy = static_cast<int>(p.topology);
+    const double tdim = static_cast<double>(tdim_);
+    const double halftdim = tdim / 2.0;
+
+    // INPUTS STAGE 1
+    const double InLeft = in1, InRight = in2;
+    const double preMasterDelay = MsToSamps(p.InitialDelay);
+    const double MasterDelay = RSmooth(delaySmooth_, preMasterDelay, 0.1247);
+    const double MechanicalNoise = in3;
+
+    double Flutter = 0.0, globalphase = 0.0, driveTape1L = 0.0;
+    double TH1L = 0.0, TH1R = 0.0, TH2L = 0.0, TH2R = 0.0;
+    double VU1 = 0.0, VU2 = 0.0, VU3 = 0.0;
+    double OutLeft = 0.0, OutRight = 0.0;
+    double FeedbackLeft = 0.0, FeedbackRight = 0.0;
+    double fbamp = 0.0, sHMdelta = 0.0;
+
+    if (M == 0) {
+        // INPUTS STAGE 2
+        const double holdsmooth = SmpSmooth(holdSmooth_, H, 0.9995);
+        const double invhs = 1.0 - holdsmooth;
+        Flutter = H != 0.0 ? 0.0 : MsToSamps(MechanicalNoise);
+        const double inL = InLeft * invhs;
+        const double inR = InRight * invhs;
+        const double wdmixL = fbL_ + inL;
+        const double wdmixR = fbR_ + inR;
+
+        // FEEDBACK & HOLD STAGE
+        double prefeedamp;
+        if (q > 0) prefeedamp = (tplgy != 3) ? 1.578 : 1.422;
+        else prefeedamp = (tplgy != 3) ? 1.333 : 1.211;
+        const double intensitysmooth = H != 0.0 ? 1.0 : p.intensity;
+        const double postfeedamp = intensitysmooth * (H != 0.0 ? p.holdatten : prefeedamp);
+        fbamp = Cpsm(fbampSmooth_, postfeedamp, 0.999);
+        const double is2 = intensitysmooth * intensitysmooth;
+        const double char2 = p.character * p.character;
+        const double resmod0 = ((char2 * 0.08736) + is2) + 0.01;
+        const double resmod1 = p.character + 0.01;
+
+        // AMP SIMULATION STAGE
+        double satOutL = 0.0, satOutR = 0.0, env2 = 0.0;
+        if (holdsmooth < 0.999984) {
+            // ENVELOPE STAGE
+            double modifier = 0.0, agc = 0.0, compen = 0.0;
+            double Amix = 0.0, Cmix = 0.0, Mmix = 0.0, S = 0.0;
+            if (q > 0) {
+                const double follow = (inL + inR) * SQRT1_2;
+                if (p.intensity < 1.0) {
+                    const double c = p.character;
+                    const double range = (char2 * 0.876) + 0.25;
+                    const double attack = ((1.0 - c) * 0.3863) + 0.0157;
+                    const double decay = ((1.0 - char2) * 0.5514) + 0.0236;
+                    const double decaymult = (c * 0.056) + 0.104;
+                    double env1;
+                    Env(follow, range, attack, decay, decaymult, ew, env1, env2);
+                    agc = (env1 * 0.719233) + 0.803526;
+                    if (ew) {
+                        const double precompen = cw ? ((env2 * 0.719233) + 0.794328) : agc;
+                        compen = std::fmin(SafeDiv(1.0, std::fmin(precompen, DbToA((char2 * 2.0) + 1.0))), 1.122018);
+                    } else {
+                        compen = std::fmin(SafeDiv(1.0, std::fmin(agc, DbToA(((1.0 - char2) * 2.0) + 1.4))), 1.0);
+                    }
+                    const double modcompress = (c * 0.28) + 0.51;
+                    modifier = ((env1 * modcompress) + (1.0 - modcompress)) + (c * 0.347);
+                    const double skew = (char2 * 0.019) + 0.001;
+
+                    // PURIFY STAGE
+                    if (p.intensity > 0.384615) {
+                        const double intense = (std::fmax(intensitysmooth, 0.384615) - 0.384615) * 1.624999;
+                        Amix = Mix(agc, 1.001152, intense);
+                        Cmix = Mix(compen, 0.988553, intense);
+                        Mmix = Mix(modifier, 0.491438, intense);
+                        S = 0.0;
+                    } else {
+                        Amix = agc;
+                        Cmix = compen;
+                        Mmix = modifier;
+                        S = skew;
+                    }
+                } else {
+                    Amix = 1.001152;
+                    Cmix = 0.988553;
+                    Mmix = 0.491438;
+                    agc = Amix;
+                    compen = Cmix;
+                    modifier = Mmix;
+                    env2 = 0.0;
+                }
+            } else {
+                modifier = SQRT1_2;
+                Amix = 1.001152;
+                Cmix = 0.988553;
+                env2 = 0.0;
+                if (nl == 2) {
+                    agc = Amix;
+                    compen = Cmix;
+                }
+            }
+
+            // SATURATION STAGE
+            const double doppelAgc = DbToA(modifier * (p.character * 3.0));
+            const double satInL = (wdmixL * Amix) * doppelAgc;
+            const double satInR = (wdmixR * Amix) * doppelAgc;
+            double satL, satR;
+            if (q == 2) {
+                satL = Sat(nl, satInL, Mmix, satDcL_);
+                satR = Sat(nl, satInR, Mmix - S, satDcR_);
+            } else {
+                const double dvlL = satInL * 0.25;
+                const double dvlR = satInR * 0.25;
+                double drivelutL, drivelutR, cp;
+                if (nl == 2) {
+                    cp = compen;
+                    drivelutL = Clip(dvlL, -1.0, 1.0) * agc;
+                    drivelutR = Clip(dvlR, -1.0, 1.0) * agc;
+                } else {
+                    cp = 1.0;
+                    drivelutL = dvlL;
+                    drivelutR = dvlR;
+                }
+                satL = Lookup(drivelutL, nl, q > 0) * cp;
+                satR = Lookup(drivelutR, nl, q > 0) * cp;
+            }
+            const double doppelCompen = (q != 0) ? SafeDiv(0.944061, doppelAgc)
+                                                 : std::fmin(SafeDiv(1.412538, doppelAgc), 1.0);
+            satOutL = (satL * Cmix) * doppelCompen;
+            satOutR = (satR * Cmix) * doppelCompen;
+        }
+
+        // MIX STAGE
+        const double TapeL = (wdmixL * holdsmooth) + (satOutL * invhs);
+        const double TapeR = (wdmixR * holdsmooth) + (satOutR * invhs);
+
+        // RECORD TO TAPE STAGE
+        globalphase = Wrap(globalaccum_ + 1.0, 0.0, tdim);
+        const double writephase0 = Wrap(globalphase, 0.0, halftdim);
+        const double writephase1 = writephase0 + halftdim;
+        const double readdelay = Wrap(globalphase - MasterDelay, 0.0, tdim);
+        const double phasetrap = Clip(SafeDiv(Wrap(readdelay, 0.0, MasterDelay), MasterDelay), 0.0, 1.0);
+        const size_t w0 = static_cast<size_t>(writephase0), w1 = static_cast<size_t>(writephase1);
+        tape_[0][w0] = static_cast<float>(TapeL);
+        tape_[1][w0] = static_cast<float>(TapeR);
+        tape_[0][w1] = static_cast<float>(TapeL);
+        tape_[1][w1] = static_cast<float>(TapeR);
+
+        // CAPSTAN & PINCH ROLLER STAGE
+        double MasterPhase;
+        if (H > 0.0 || !(p.wow > 0.000002)) {
+            MasterPhase = Wrap(readdelay, 0.0, tdim);
+        } else {
+            const double wowMax = MsToSamps(4.249);
+            const double wctrl = SmpSmooth(wowSmooth_, (1.0 - env2) * p.wow, 0.9995);
+            const double feedlfo = Clip(SafeDiv(head1_, tdim), 0.0, 1.0);
+            const double wlfo = sinApp01(feedlfo) * ((Triangle(phasetrap) * 0.45) + 0.225);
+            const double ctrllfo = wlfo * wctrl;
+            const double capstanwow = (dir > 0) ? (ctrllfo * 0.225) : ctrllfo;
+            const double wowActual = capstanwow + ((p.character * 0.0003) - 0.000075);
+            MasterPhase = Wrap(readdelay + (wowActual * wowMax), 0.0, tdim);
+        }
+
+        // DELAYS AND MODESELECTOR STAGE
+        double trapmul, delay2, delay3, delay4;
+        double driveRev1L = 0.0, driveRev1R = 0.0;
+        double munge1 = 0.0, munge2 = 0.0;
+        if (!(H > 0.0)) {
+            munge1 = munge_[0].ReadLinear(606.0);
+            munge2 = munge_[1].ReadLinear(808.0);
+        }
+        if (dir == 1) {
+            double trapphase, tramp;
+            const double postMasterDelay = revDelaySah_(preMasterDelay, syncRevMaster_, 0.5);
+            bool delaydelta;
+            const double delayphase = revCounter_(1.0, postMasterDelay, delaydelta);
+            double rphase1;
+            if (revstyle == 0) {
+                const double reverseheads = tdim - MasterPhase;
+                const double halftdimm2 = halftdim - 2.0;
+                tramp = 0.077;
+                const double pretraph = SafeDiv(Wrap((writephase0 + 1.0) - reverseheads, 0.0, halftdimm2), halftdimm2);
+                trapphase = Wrap(pretraph - tramp, 0.0, 1.0);
+                rphase1 = Wrap(reverseheads, writephase0 + 1.0, writephase1 - 1.0);
+                delay4 = postMasterDelay + Flutter + 1.0;
+            } else {
+                const double reverseloop = revLoopSah_(postMasterDelay, delaydelta ? 1.0 : 0.0, 0.5) - delayphase;
+                trapphase = Clip(SafeDiv(delayphase, postMasterDelay), 0.0, 1.0);
+                tramp = 0.04;
+                rphase1 = (reverseloop - 1.0) + (revPhaseSah_(MasterPhase, delaydelta ? 1.0 : 0.0, 0.5) - 1.0);
+                delay4 = postMasterDelay + Flutter - 1.0;
+            }
+            driveRev1L = Wrap(rphase1 + Flutter, 0.0, tdim);
+            driveRev1R = Wrap(rphase1 + munge1, 0.0, tdim);
+            delay2 = postMasterDelay + munge2;
+            delay3 = postMasterDelay + Flutter;
+            trapmul = hTrap(trapphase, 0.0, 1.0, tramp, 1.0 - tramp);
+            syncRevMaster_ = revDelta_(trapphase) < 0.0 ? 1.0 : 0.0;
+        } else {
+            delay2 = MasterDelay + munge2;
+            delay3 = MasterDelay + Flutter;
+            delay4 = delay3;
+            trapmul = 1.0;
+            syncRevMaster_ = 1.0;
+        }
+
+        const double faze = MasterPhase;
+        driveTape1L = Wrap(faze + Flutter, 0.0, tdim);
+        const double driveTape1R = Wrap(faze + munge1, 0.0, tdim);
+        double multrap = 1.0;
+        bool ss = false;
+        if (H > 0.0) {
+            double pu, arriere;
+            if (preMasterDelay < 10000.0) {
+                const double pMDclip = Clip(preMasterDelay, 0.0, 10000.0);
+                const double rier = pMDclip / 10000.0;
+                pu = Scale(pMDclip, 0.0, 10000.0, 0.0, 0.05, 2.438);
+                arriere = Clip(1.0 - (rier * rier), 0.0, 0.501);
+                ss = true;
+            } else {
+                pu = 0.05;
+                arriere = 0.0;
+            }
+            multrap = hTrap(phasetrap, arriere, 1.0, pu, 1.0 - pu);
+        }
+        sHMdelta = holdDelta_(phasetrap) < 0.0 ? 1.0 : 0.0;
+        const double AllPlayL = SampleTape(driveTape1L, 0, true) * multrap;
+        const double AllPlayR = SampleTape(driveTape1R, 1, true) * multrap;
+        if (dir > 0) {
+            TH1L = SampleTape(driveRev1L, 0, false) * trapmul;
+            TH1R = SampleTape(driveRev1R, 1, false) * trapmul;
+        } else {
+            TH1L = AllPlayL;
+            TH1R = AllPlayR;
+        }
+        if (H > 0.0) {
+            if (ss) {
+                const double hLw = Scale(MasterDelay, 10.0, 250.0, 2570.0, 10700.0, 2.0);
+                TH1L = holdPzL_(0, TH1L, hLw, sr);
+                TH1R = holdPzR_(0, TH1R, hLw, sr);
+            }
+            TH1L = softStatic(TH1L);
+            TH1R = softStatic(TH1R);
+        }
+
+        // matt's Mode Selectors
+        const double Mode = p.Mode;
+        const double Hold = p.Hold;
+        double DL = 0.0, DR = 0.0, TH3L = 0.0, TH3R = 0.0;
+        auto heads23 = [&](double d2, double d3) {
+            TH2L = head2L_.ReadCubic(d2);
+            TH2R = head2R_.ReadCubic(d3);
+            TH3L = head3L_.ReadCubic(delay4);
+            TH3R = head3R_.ReadCubic(delay4);
+        };
+        if (Mode == 1.0 || Mode == 5.0) {
+            DL = TH1L;
+            DR = TH1R;
+            TH2L = TH1L;
+            TH2R = TH1R;
+            VU1 = TH1L + TH1R;
+        } else if (Mode == 2.0 || Mode == 6.0) {
+            if (H > 0.0) {
+                TH2L = head2L_.ReadCubic(delay2);
+                TH2R = head2R_.ReadCubic(delay3);
+            } else if (Mode == 2.0) {
+                TH2L = head2L_.ReadCubic(delay2);
+                TH2R = head2R_.ReadCubic(delay3 - 404.0);   // for matt
+            } else {
+                TH2L = head2L_.ReadCubic(delay2 + 404.0);   // for fun
+                TH2R = head2R_.ReadCubic(delay3);
+            }
+            DL = TH2R;
+            DR = TH2L;
+            VU2 = TH2L + TH2R;
+        } else if (Mode == 3.0) {
+            heads23(delay2, delay3);
+            DL = TH3R;
+            DR = TH3L;
+            VU3 = TH3L + TH3R;
+        } else if (Mode == 4.0) {
+            heads23(delay2, delay3);
+            DL = plus2A(TH2R, TH3R) * hscale(1, Hold);
+            DR = plus2A(TH2L, TH3L) * hscale(1, Hold);
+            VU2 = TH2L + TH2R;
+            VU3 = TH3L + TH3R;
+        } else if (Mode == 7.0) {
+            heads23(delay2, H > 0.0 ? delay3 : delay3 - 404.0);   // for pete
+            DL = TH3R;
+            DR = TH3L;
+            VU3 = TH3L + TH3R;
+        } else if (Mode == 8.0) {
+            TH2L = head2L_.ReadCubic(delay2);
+            TH2R = head2R_.ReadCubic(delay3);
+            DL = plus2A(TH1L, TH2R) * hscale(1, Hold);
+            DR = plus2C(TH1R, TH2L) * hscale(3, Hold);
+            VU1 = TH1L + TH1R;
+            VU2 = TH2L + TH2R;
+        } else if (Mode == 9.0) {
+            heads23(delay2, delay3);
+            DL = plus2A(TH2R, TH3R) * hscale(1, Hold);
+            DR = plus2C(TH2L, TH3L) * hscale(3, Hold);
+            VU2 = TH2L + TH2R;
+            VU3 = TH3L + TH3R;
+        } else if (Mode == 10.0) {
+            heads23(delay2, delay3);
+            DL = plus2A(TH1L, TH3R) * hscale(1, Hold);
+            DR = plus2C(TH1R, TH3L) * hscale(3, Hold);
+            VU1 = TH1L + TH1R;
+            VU3 = TH3L + TH3R;
+        } else if (Mode == 11.0) {
+            heads23(delay2, delay3);
+            DL = plus2B(((TH1L + TH2R) * 0.666667), TH3R) * hscale(2, Hold);
+            DR = (plus2D((plus2C(TH1R, TH2L) * hscale(3, Hold)), TH3L)) * hscale(3, Hold);
+            VU1 = TH1L + TH1R;
+            VU2 = TH2L + TH2R;
+            VU3 = TH3L + TH3R;
+        } else {
+            // Mode 12: solo reverb, no heads
+            TH2L = TH2R = 0.0;
+        }
+
+        // RECORD HEAD TRAP FILTERS AND HYSTERISIS STAGE
+        if (H > 0.0) {
+            OutLeft = DL;
+            OutRight = DR;
+            if (dir > 0) {
+                FeedbackLeft = AllPlayL;
+                FeedbackRight = AllPlayR;
+            } else {
+                FeedbackLeft = OutLeft;
+                FeedbackRight = OutRight;
+            }
+        } else {
+            double hat1, hat2, freqatt = 0.0, yL, yR;
+            if (tplgy != 0) {
+                double rmul = ((intensitysmooth * resmod1) * 0.99) + 0.01;
+                double rm0 = (std::fmax(resmod0, 0.0) * 0.45264) + 0.04;
+                rmul = SmpSmooth(rmulSmooth_, rmul, 0.9995);
+                rm0 = SmpSmooth(rm0Smooth_, rm0, 0.9995);
+                const double rm105 = resmod1 * 0.666667;
+                const double rm1025 = rm105 * 0.666667;
+                const double rm01 = rm0 + rm105;
+                if (tplgy == 1) {
+                    const double freqmult = SmpSmooth(lofiFreqSmooth_, (intensitysmooth * -0.06) + 0.72, 0.9995);
+                    const double yL0 = lofiLpL_(0, DL, 2240.0 * freqmult, sr);
+                    const double yR0 = lofiLpR_(0, DR, 2240.0 * freqmult, sr);
+                    yL = lofiHpL_(yL0, 35.0 * rmul, rm0 * rmul, sr);
+                    yR = lofiHpR_(yR0, 36.0 * rmul, rm0 * rmul, sr);
+                    hat1 = 0.0001;
+                    hat2 = 0.0001;
+                } else if (tplgy == 2) {
+                    const double freqmult = SmpSmooth(oldFreqSmooth_, (((Clip(is2, 0.5, 1.0) * 2.0) - 1.0) * -0.07) + 1.0, 0.9995);
+                    const double rmod = rm0 * ((is2 * -0.875) + 1.0);
+                    const double rmd = std::fmin(((rm01 * ((is2 * -0.875) + 1.0)) + rm1025), 0.97);
+                    const double yL0 = oldLpL_(0, DL, 3699.0 * freqmult, rmod, sr);
+                    const double yR0 = oldLpR_(0, DR, 3699.0 * freqmult, rmod, sr);
+                    yL = oldHpL_(1, yL0 * 0.922571, 214.0 * rmd, sr);
+                    yR = oldHpR_(1, yR0 * 0.922571, 214.0 * rmd, sr);
+                    hat1 = 0.002;
+                    hat2 = 0.002;
+                } else {
+                    const double freqmult = SmpSmooth(darkFreqSmooth_, intensitysmooth + 1.0, 0.9995);
+                    const double rmod = rm0 * (1.0 - (is2 * 0.5));
+                    const double rmd = ((std::fmin((rm01 * (1.0 - (is2 * 0.5))), 0.97) * rmul) * is2) * 0.808;
+                    const double yL0 = darkLpL_(0, DL, 3699.0 * freqmult, rmod, sr);
+                    const double yR0 = darkLpR_(0, DR, 3699.0 * freqmult, rmod, sr);
+                    const double sL = darkHpL_(1, yL0 * 0.822243, 145.0 * rmul, std::fmax(rmd, 0.11), sr);
+                    const double sR = darkHpR_(1, yR0 * 0.822243, 148.0 * rmul, std::fmax(rmd, 0.11), sr);
+                    yL = simpSat(sL * 0.822243) * 0.906776;
+                    yR = simpSat(sR * 0.822243) * 0.906776;
+                    hat1 = 0.003;
+                    hat2 = 0.002;
+                }
+            } else {
+                freqatt = SmpSmooth(freqattSmooth_, p.freqatten, 0.9995);
+                const double yL0 = lpL_(0, DL, 2000.0 * freqatt, sr);
+                const double yR0 = lpR_(0, DR, 2000.0 * freqatt, sr);
+                yL = hpL_(1, yL0, 147.0, sr);
+                yR = hpR_(1, yR0, 147.0, sr);
+                hat1 = 0.001;
+                hat2 = 0.0002;
+            }
+
+            if (dir == 1) {
+                const double freqa = (tplgy == 0) ? freqatt : SmpSmooth(freqaSmooth_, p.freqatten, 0.9995);
+                OutLeft = revDcL_(softStatic(yL));
+                OutRight = revDcR_(softStatic(yR));
+                const double prefbL = revLpL_(0, AllPlayL, 2000.0 * freqa, sr);
+                const double prefbR = revLpR_(0, AllPlayR, 2000.0 * freqa, sr);
+                FeedbackLeft = revHpL_(1, prefbL, 147.0, sr);
+                FeedbackRight = revHpR_(1, prefbR, 147.0, sr);
+            } else {
+                const double preLeft = yL * feederL_(inL, hat1, p.hysterisis);
+                const double preRight = yR * feederR_(inR, hat2, p.hysterisis);
+                OutLeft = fwdDcL_(softStatic(preLeft));
+                OutRight = fwdDcR_(softStatic(preRight));
+                FeedbackLeft = OutLeft;
+                FeedbackRight = OutRight;
+            }
+        }
+    } else if (rvRo == 1) {
+        // MUTE with 'post' reverb routing: the inputs pass
+        OutLeft = InLeft;
+        OutRight = InRight;
+    }
+
+    // OUTPUTS
+    out[0] = OutLeft;
+    out[1] = OutRight;
+    out[2] = VU1;
+    out[3] = VU2;
+    out[4] = VU3;
+
+    // UPDATES
+    globalaccum_ = globalphase;
+    head1_ = driveTape1L;
+    syncHoldMaster_ = sHMdelta;
+    munge_[0].Write(Flutter);
+    munge_[1].Write(Flutter);
+    head2L_.Write(TH1L);
+    head2R_.Write(TH1R);
+    head3L_.Write(TH2R);   // N.B. swap
+    head3R_.Write(TH2L);
+    fbL_ = FixDenorm(FeedbackLeft * fbamp);
+    fbR_ = FixDenorm(FeedbackRight * fbamp);
+    jump_ = false;
+}
+
+} // namespace host
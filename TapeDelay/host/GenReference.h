@@ -0,0 +1,223 @@
+/**
+ * Reference model of the Magnetic gen~ patch (gentildacode.cpp), for the
+ * host only.
+ *
+ * A line-by-line port of the GenExpr: the Tape buffer written twice per
+ * sample and read by the capstan phase, the head 2 / head 3 Delays, all 12
+ * modes, the three quality levels with the fatPete tables, Hold with its
+ * trapezoids, both reverse styles and the four trap filter topologies. It is
+ * written for fidelity, not speed, and follows gen~ (genlib) semantics:
+ *
+ *   - everything is double, as in Max; only the Tape is float (an MSP
+ *     buffer~) and the fatPete tables are double (gen~ Data)
+ *   - every call of a GenExpr function with a History keeps its own state,
+ *     and only moves when the branch that calls it runs
+ *   - `/` is safediv (0 for a zero divisor), Delays clamp the read to
+ *     1..size, sah / counter / delta / dcblock behave as their genlib
+ *     operators, Params clamp to their declared range
+ *
+ * The patch has one input the GenExpr does not spell out: the two-channel
+ * `mungephase` Delay is written with a single value, which is taken to go
+ * to both channels (otherwise head 2's munge2 would always be 0).
+ *
+ * tape_compare runs it next to TapeDelayCore on the same input; see there.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace host {
+
+// gen~ Params of the patch, with their defaults on load
+struct GenParams {
+    double intensity = 0.615385;   // master feedback 0..1
+    double character = 0.25;       // master style 0..1
+    double direction = 0;          // 0 forwards, 1 reverse
+    double hysterisis = 0.0002;    // feederCompression release
+    double quality = 0;            // 0..2
+    double nonlin = 0;             // 0 tanh, 1 poly, 2 cubic, 3 parabolic
+    double holdatten = 0.998531;   // feedback in Hold
+    double wow = 0.007014;         // capstan wow 0..1
+    double reversestyle = 1;       // 0 play heads, 1 delay loop
+    double rvrbRoute = 0;          // 1 passes the input in MUTE
+    double topology = 0;           // 0 '201', 1 LoFi, 2 Old, 3 Dark
+    double freqatten = 1;          // '201' lowpass at 2000 Hz times this
+    double InitialDelay = 250;     // ms, 10..1000
+    double Mode = 5;               // 1..12
+    double Hold = 0;               // 0/1
+    double MUTE = 0;               // 0/1
+
+    // The same with every Param clamped to its range, as gen~ does on input
+    GenParams Clamped() const;
+};
+
+namespace gen {
+
+// Delay with genlib's read-before-write semantics: a read of d samples
+// returns what was written d ticks ago, with d clamped to 1..size
+class DelayLine {
+  public:
+    void Init(size_t size);
+    double ReadLinear(double d) const;
+    double ReadCubic(double d) const;
+    void Write(double x);
+
+  private:
+    std::vector<double> mem_;
+    size_t mask_ = 0;
+    size_t write_ = 0;
+    double size_ = 1.0;
+};
+
+// genlib sah: takes `in` when `trig` rises through `thresh`
+struct Sah {
+    double prev = 0.0, out = 0.0;
+    double operator()(double in, double trig, double thresh) {
+        if (prev <= thresh && trig > thresh) out = in;
+        prev = trig;
+        return out;
+    }
+};
+
+// genlib counter(incr, 0, max): the count and whether it wrapped
+struct Counter {
+    double count = 0.0;
+    double operator()(double incr, double max, bool &carry);
+};
+
+// genlib delta
+struct Delta {
+    double prev = 0.0;
+    double operator()(double x) {
+        const double d = x - prev;
+        prev = x;
+        return d;
+    }
+};
+
+// genlib dcblock
+struct DcBlock {
+    double x1 = 0.0, y1 = 0.0;
+    double operator()(double x) {
+        const double y = x - x1 + y1 * 0.9997;
+        x1 = x;
+        y1 = y;
+        return y;
+    }
+};
+
+// p_SlideLite
+struct Slide {
+    double current = 0.0;
+    double operator()(double x, double up, double down);
+};
+
+// Trap filter functions of the patch, one per call site
+struct AllPole6 {   // eAllPoleLPHP6
+    double y0 = 0.0;
+    double operator()(int type, double x, double cutoff, double sr);
+};
+struct PoleZero {   // ePoleZeroLPHP
+    double r = 0.0;
+    double operator()(int type, double x, double cutoff, double sr);
+};
+struct SallenKey {  // SallenAndKey
+    double ic1eq = 0.0, ic2eq = 0.0;
+    double operator()(int type, double x, double cutoff, double res, double sr);
+};
+struct Lores {      // LoresHipass
+    double ya = 0.0, yb = 0.0;
+    double operator()(double x, double cf, double q, double sr);
+};
+struct Feeder {     // feederCompression
+    double curr = 0.0;
+    double operator()(double x, double h0, double h1);
+};
+
+} // namespace gen
+
+class GenReference {
+  public:
+    // `tape_seconds` is the size of the Tape buffer~ (the patch's 4 s, half
+    // of it reachable). With `settled`, the first sample finds every
+    // smoother already at its target and Hold as set, as if the Params had
+    // stood there for a while; otherwise the patch starts as on load (the
+    // delay glides up from 0 and Hold holds until the first loop wraps).
+    void Init(double sample_rate, double tape_seconds = 4.0, bool settled = true);
+
+    // n samples. `noise` is in3, the flutter in ms (MechanicalNoise); may
+    // be null for none. Writes out1 / out2; the meters (out3..5) of the
+    // last sample are in Meters().
+    void Process(const GenParams &params, const float *inL, const float *inR, const float *noise,
+                 float *outL, float *outR, size_t n);
+
+    const double *Meters() const { return meters_; }
+
+  private:
+    // One gen~ tick; out[0..4] = out1..out5
+    void Tick(const GenParams &p, double in1, double in2, double in3, double *out);
+
+    // Smoothers with a History, jumping to the input on a settled start
+    double SmpSmooth(double &h, double v, double s);
+    double Cpsm(double &h, double a, double f);
+    double RSmooth(double &h, double x, double s);
+    // p_Env
+    void Env(double x, double r, double a, double d, double m, bool t, double &env1, double &env2);
+    // sat() for quality 2
+    double Sat(int nl, double x, double mod, gen::DcBlock &dc) const;
+    // lookup(fatPete, x, nl) with clamped bounds, cubic or cosine
+    double Lookup(double x, int nl, bool cubic) const;
+    // sample(Tape, pos, ch) with wrapped bounds, cubic or cosine
+    double SampleTape(double pos, int ch, bool cubic) const;
+    double MsToSamps(double ms) const { return ms * sample_rate_ * 0.001; }
+
+    double sample_rate_ = 48000.0;
+    bool jump_ = false;
+    double meters_[3] = {};
+
+    // Buffer Tape (tdim frames, 2 channels) and Data fatPete (16384 x 4)
+    size_t tdim_ = 0;
+    std::vector<float> tape_[2];
+    std::vector<double> fatPete_[4];
+
+    // Top level History
+    double globalaccum_ = 0.0;
+    double syncHoldMaster_ = 1.0;
+    double syncRevMaster_ = 1.0;
+    double head1_ = 0.0;
+    double fbL_ = 0.0, fbR_ = 0.0;
+
+    // Delays
+    gen::DelayLine munge_[2];
+    gen::DelayLine head2L_, head2R_, head3L_, head3R_;
+
+    // Per call site state, in the order the patch runs them
+    gen::Sah holdSah_;
+    double delaySmooth_ = 0.0, holdSmooth_ = 0.0, fbampSmooth_ = 0.0;
+    gen::Slide envSlide1_, envSlide2_;
+    gen::DcBlock satDcL_, satDcR_;
+    double wowSmooth_ = 0.0;
+    gen::Sah revDelaySah_, revLoopSah_, revPhaseSah_;
+    gen::Counter revCounter_;
+    gen::Delta revDelta_, holdDelta_;
+    gen::PoleZero holdPzL_, holdPzR_;
+    double rmulSmooth_ = 0.0, rm0Smooth_ = 0.0;
+    double lofiFreqSmooth_ = 0.0, oldFreqSmooth_ = 0.0, darkFreqSmooth_ = 0.0;
+    gen::PoleZero lofiLpL_, lofiLpR_;
+    gen::Lores lofiHpL_, lofiHpR_;
+    gen::SallenKey oldLpL_, oldLpR_;
+    gen::AllPole6 oldHpL_, oldHpR_;
+    gen::SallenKey darkLpL_, darkLpR_, darkHpL_, darkHpR_;
+    double freqattSmooth_ = 0.0;
+    gen::AllPole6 lpL_, lpR_, hpL_, hpR_;
+    double freqaSmooth_ = 0.0;
+    gen::AllPole6 revLpL_, revLpR_, revHpL_, revHpR_;
+    gen::DcBlock revDcL_, revDcR_;
+    gen::Feeder feederL_, feederR_;
+    gen::DcBlock fwdDcL_, fwdDcR_;
+};
+
+} // namespace host
@@ -0,0 +1,120 @@
+/**
+ * Mock panel for the host tools.
+ *
+ * Stands in for the Patch SM knobs, CV, buttons, Gate In 1 and the millisecond
+ * system clock: knob values are fixed for a run unless moved at given times,
+ * the clock is generated at a fixed tempo and button presses are scheduled
+ * at given times. Frame() builds the ControlFrame the firmware would have
+ * read at the start of a block, with ADC noise on the knobs if asked for.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../TapeCore.h"
+
+namespace host {
+
+class MockControls {
+  public:
+    void Init(float sample_rate) { sample_rate_ = sample_rate; }
+
+    // Knob positions, 0..1, plus any CV offset already summed in
+    float time = 0.35f;
+    float feedback = 0.5f;
+    float mix = 0.5f;
+    float tone = 0.7f;
+    float flutter = 0.1f;
+
+    // Knob moves: at `time` seconds, knob `knob` (Knob) jumps to `value`
+    enum Knob { KNOB_TIME, KNOB_FEEDBACK, KNOB_MIX, KNOB_TONE, KNOB_FLUTTER, KNOB_COUNT };
+    struct Move {
+        double time;
+        int knob;
+        float value;
+    };
+    std::vector<Move> moves;
+
+    // Peak uniform noise on every knob reading, as from a jittery ADC
+    float jitter = 0.0f;
+
+    // Knob index for a name, or -1
+    static int KnobIndex(const char *name) {
+        static const char *const names[KNOB_COUNT] = {"time", "feedback", "mix", "tone", "flutter"};
+        for (int k = 0; k < KNOB_COUNT; k++) {
+            if (std::strcmp(name, names[k]) == 0) return k;
+        }
+        return -1;
+    }
+
+    // Gate In 1 clock; 0 disables the clock. Each edge can be moved by up
+    // to clock_jitter samples either way, as from a loose clock source.
+    float clock_bpm = 0.0f;
+    float clock_jitter = 0.0f;
+
+    // Button presses, in seconds from the start of the render
+    std::vector<double> freeze_presses;
+    std::vector<double> reverse_presses;
+
+    tape::ControlFrame Frame(uint64_t block_start, size_t block_size) const {
+        tape::ControlFrame ctl;
+        float knobs[KNOB_COUNT] = {time, feedback, mix, tone, flutter};
+        for (const Move &m : moves) {
+            if (m.time * sample_rate_ <= static_cast<double>(block_start)) knobs[m.knob] = m.value;
+        }
+        if (jitter > 0.0f) {
+            for (int k = 0; k < KNOB_COUNT; k++) knobs[k] += jitter * Noise(block_start * KNOB_COUNT + k);
+        }
+        ctl.time = knobs[KNOB_TIME];
+        ctl.feedback = knobs[KNOB_FEEDBACK];
+        ctl.mix = knobs[KNOB_MIX];
+        ctl.tone = knobs[KNOB_TONE];
+        ctl.flutter = knobs[KNOB_FLUTTER];
+
+        const uint64_t block_end = block_start + block_size;
+        ctl.freeze_pressed = AnyIn(freeze_presses, block_start, block_end);
+        ctl.reverse_pressed = AnyIn(reverse_presses, block_start, block_end);
+
+        if (clock_bpm > 0.0f) {
+            // Edges land on the first sample at or after their time
+            const double period = 60.0 * sample_rate_ / clock_bpm;
+            const double first = (static_cast<double>(block_start) - clock_jitter) / period;
+            for (int64_t k = first < 0.0 ? 0 : static_cast<int64_t>(first);; k++) {
+                const double t = static_cast<double>(k) * period + clock_jitter * Noise(static_cast<uint64_t>(k) ^ 0x5bd1e995u);
+                const double edge = std::ceil(t);
+                if (edge >= static_cast<double>(block_end) + clock_jitter) break;
+                if (edge >= static_cast<double>(block_start) && edge < static_cast<double>(block_end)) {
+                    ctl.clock_trig = true;
+                    ctl.clock_offset = static_cast<size_t>(edge - static_cast<double>(block_start));
+                }
+            }
+        }
+        return ctl;
+    }
+
+  private:
+    // Uniform in [-1, 1), the same for the same n on every run
+    static float Noise(uint64_t n) {
+        uint32_t x = static_cast<uint32_t>(n) * 2654435761u + 0x9e3779b9u;
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        return static_cast<float>(static_cast<int32_t>(x)) * (1.0f / 2147483648.0f);
+    }
+
+    bool AnyIn(const std::vector<double> &times, uint64_t start, uint64_t end) const {
+        for (double t : times) {
+            const double s = t * sample_rate_;
+            if (s >= static_cast<double>(start) && s < static_cast<double>(end)) return true;
+        }
+        return false;
+    }
+
+    float sample_rate_ = 48000.0f;
+};
+
+} // namespace host
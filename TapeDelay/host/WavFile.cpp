@@ -0,0 +1,184 @@
+#include "WavFile.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace host {
+
+namespace {
+
+constexpr uint16_t FORMAT_PCM = 1;
+constexpr uint16_t FORMAT_FLOAT = 3;
+constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t ReadU16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+uint32_t ReadU32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+void PutU16(uint8_t *p, uint16_t v) { p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+void PutU32(uint8_t *p, uint32_t v) {
+    p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); p[2] = uint8_t(v >> 16); p[3] = uint8_t(v >> 24);
+}
+
+} // namespace
+
+// --------------------------------------------------------------------------
+// READER
+// --------------------------------------------------------------------------
+
+bool WavReader::Open(const std::string &path, std::string &error) {
+    Close();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, file_) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+        error = path + " is not a RIFF/WAVE file";
+        Close();
+        return false;
+    }
+
+    bool have_fmt = false;
+    uint16_t format = 0;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file_) == 8) {
+        uint32_t size = ReadU32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4)) {
+            std::vector<uint8_t> fmt(size);
+            if (size < 16 || fread(fmt.data(), 1, size, file_) != size) break;
+            format = ReadU16(&fmt[0]);
+            channels_ = ReadU16(&fmt[2]);
+            sample_rate_ = ReadU32(&fmt[4]);
+            bits_ = ReadU16(&fmt[14]);
+            if (format == FORMAT_EXTENSIBLE && size >= 26) format = ReadU16(&fmt[24]);
+            if (size & 1) fseek(file_, 1, SEEK_CUR);
+            have_fmt = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!have_fmt) break;
+            is_float_ = (format == FORMAT_FLOAT);
+            bool supported = (is_float_ && bits_ == 32)
+                             || (format == FORMAT_PCM && (bits_ == 16 || bits_ == 24 || bits_ == 32));
+            if (!supported || channels_ == 0) {
+                error = path + ": unsupported sample format";
+                Close();
+                return false;
+            }
+            frames_total_ = size / (channels_ * (bits_ / 8));
+            frames_left_ = frames_total_;
+            return true;
+        } else {
+            fseek(file_, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    error = path + ": no audio data";
+    Close();
+    return false;
+}
+
+void WavReader::Close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+}
+
+size_t WavReader::Read(float *interleaved, size_t frames) {
+    if (!file_) return 0;
+    if (frames > frames_left_) frames = frames_left_;
+
+    const size_t bytes_per_sample = bits_ / 8;
+    const size_t samples = frames * channels_;
+    std::vector<uint8_t> raw(samples * bytes_per_sample);
+    size_t got = fread(raw.data(), bytes_per_sample * channels_, frames, file_);
+
+    const uint8_t *p = raw.data();
+    for (size_t i = 0; i < got * channels_; i++, p += bytes_per_sample) {
+        float s;
+        if (is_float_) {
+            memcpy(&s, p, 4);
+        } else if (bits_ == 16) {
+            s = int16_t(ReadU16(p)) / 32768.0f;
+        } else if (bits_ == 24) {
+            int32_t v = int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24);
+            s = (v >> 8) / 8388608.0f;
+        } else {
+            s = int32_t(ReadU32(p)) / 2147483648.0f;
+        }
+        interleaved[i] = s;
+    }
+    frames_left_ -= got;
+    return got;
+}
+
+// --------------------------------------------------------------------------
+// WRITER
+// --------------------------------------------------------------------------
+
+bool WavWriter::Open(const std::string &path, uint32_t sample_rate, uint16_t channels,
+                     Format format, std::string &error) {
+    Close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        error = "cannot create " + path;
+        return false;
+    }
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    format_ = format;
+    frames_written_ = 0;
+    WriteHeader();
+    return true;
+}
+
+void WavWriter::WriteHeader() {
+    const uint16_t bits = (format_ == Format::PCM16) ? 16 : 32;
+    const uint16_t block_align = uint16_t(channels_ * bits / 8);
+    const uint32_t data_bytes = uint32_t(frames_written_ * block_align);
+
+    uint8_t h[44];
+    memcpy(h, "RIFF", 4);
+    PutU32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    PutU32(h + 16, 16);
+    PutU16(h + 20, format_ == Format::PCM16 ? FORMAT_PCM : FORMAT_FLOAT);
+    PutU16(h + 22, channels_);
+    PutU32(h + 24, sample_rate_);
+    PutU32(h + 28, sample_rate_ * block_align);
+    PutU16(h + 32, block_align);
+    PutU16(h + 34, bits);
+    memcpy(h + 36, "data", 4);
+    PutU32(h + 40, data_bytes);
+
+    fseek(file_, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), file_);
+    fseek(file_, 0, SEEK_END);
+}
+
+void WavWriter::Close() {
+    if (!file_) return;
+    WriteHeader();
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void WavWriter::Write(const float *interleaved, size_t frames) {
+    if (!file_) return;
+    const size_t samples = frames * channels_;
+    if (format_ == Format::FLOAT32) {
+        fwrite(interleaved, sizeof(float), samples, file_);
+    } else {
+        std::vector<uint8_t> raw(samples * 2);
+        for (size_t i = 0; i < samples; i++) {
+            float s = fminf(fmaxf(interleaved[i], -1.0f), 1.0f);
+            PutU16(&raw[i * 2], uint16_t(int16_t(lrintf(s * 32767.0f))));
+        }
+        fwrite(raw.data(), 1, raw.size(), file_);
+    }
+    frames_written_ += frames;
+}
+
+} // namespace host
@@ -0,0 +1,65 @@
+/**
+ * Minimal streaming RIFF/WAVE reader and writer for the host tools.
+ *
+ * Reads 16/24/32-bit PCM and 32-bit float files, writes 16-bit PCM or 32-bit
+ * float. Samples are exchanged as interleaved floats in -1..1, a block at a
+ * time, so arbitrarily long files never have to fit in memory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace host {
+
+class WavReader {
+  public:
+    ~WavReader() { Close(); }
+
+    // Returns false and fills `error` if the file cannot be used.
+    bool Open(const std::string &path, std::string &error);
+    void Close();
+
+    // Read up to `frames` interleaved frames; returns the number read.
+    size_t Read(float *interleaved, size_t frames);
+
+    uint32_t SampleRate() const { return sample_rate_; }
+    uint16_t Channels() const { return channels_; }
+    uint64_t Frames() const { return frames_total_; }
+
+  private:
+    FILE *file_ = nullptr;
+    uint32_t sample_rate_ = 0;
+    uint16_t channels_ = 0;
+    uint16_t bits_ = 0;
+    bool is_float_ = false;
+    uint64_t frames_total_ = 0;
+    uint64_t frames_left_ = 0;
+};
+
+class WavWriter {
+  public:
+    enum class Format { PCM16, FLOAT32 };
+
+    ~WavWriter() { Close(); }
+
+    bool Open(const std::string &path, uint32_t sample_rate, uint16_t channels,
+              Format format, std::string &error);
+    // Patches the RIFF / data sizes into the header and closes the file.
+    void Close();
+
+    void Write(const float *interleaved, size_t frames);
+
+  private:
+    void WriteHeader();
+
+    FILE *file_ = nullptr;
+    uint32_t sample_rate_ = 0;
+    uint16_t channels_ = 0;
+    Format format_ = Format::FLOAT32;
+    uint64_t frames_written_ = 0;
+};
+
+} // namespace host
@@ -0,0 +1,1312 @@
+/**
+ * tape_bench: host-side cost / accuracy comparisons for DSP building blocks.
+ *
+ *   tape_bench [--json FILE] [--rev NAME] [--m7-ratio R] [suite ...]
+ *
+ * No suite names runs every suite. `kernels` times each DSP primitive on its
+ * own and, with --json, also writes its results to FILE tagged with NAME
+ * (e.g. the git revision) so they can be tracked across firmware revisions.
+ *
+ * Timings are host nanoseconds per sample and only meaningful relative to each
+ * other. This file is built without auto-vectorisation (see Makefile) so the
+ * kernels run one sample at a time, as on the Cortex-M7; use the firmware's
+ * PROFILE=stages build for real M7 cycle counts. A few suites also check
+ * behaviour (marked FAIL in the output, and tape_bench then exits 1).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../TapeCore.h"
+#include "Bench.h"
+
+namespace {
+
+// --------------------------------------------------------------------------
+// SATURATION: tnhLam vs the fatPete lookup table
+// --------------------------------------------------------------------------
+
+void SuiteSat() {
+    printf("== sat: direct curves vs SatTable (input: +-5 sine, slowly swept)\n");
+    std::vector<float> input = host::SineSweep(1 << 16, 5.0f);
+
+    printf("%-30s %10s %12s %12s\n", "kernel", "ns/sample", "max err", "rms err");
+    static tape::SatTable table;
+    for (int nl = 0; nl < tape::NONLIN_COUNT; nl++) {
+        table.Init(nl);
+        const char *names[] = {"tanh (tnhLam)", "poly (polysat)", "cubic (cnl)", "parabolic (parsat)"};
+
+        double direct = host::NsPerSample(input, [nl](float x) { return tape::EvalNonlin(nl, x); });
+        double lut = host::NsPerSample(input, [](float x) { return table.LookupCosine(x); });
+
+        // Accuracy against the curve itself over the table range, dense sweep
+        double max_err = 0.0, sum_sq = 0.0;
+        const int steps = 1 << 20;
+        for (int i = 0; i <= steps; i++) {
+            float x = -4.0f + 8.0f * static_cast<float>(i) / steps;
+            double e = fabs(static_cast<double>(table.LookupCosine(x)) - tape::EvalNonlin(nl, x));
+            if (e > max_err) max_err = e;
+            sum_sq += e * e;
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "%s direct", names[nl]);
+        printf("%-30s %10.2f %12s %12s\n", label, direct, "-", "-");
+        snprintf(label, sizeof(label), "%s LUT cosine", names[nl]);
+        printf("%-30s %10.2f %12.3g %12.3g\n", label, lut, max_err, sqrt(sum_sq / (steps + 1)));
+    }
+
+    // Beyond the table the LUT clamps at the +-4 value; tnhLam keeps rising
+    table.Init(tape::NONLIN_TANH);
+    double tail = 0.0;
+    for (float x = 4.0f; x < 16.0f; x += 0.001f) {
+        tail = fmax(tail, fabs(table.LookupCosine(x) - tape::tnhLam(x)));
+    }
+    printf("tanh LUT max err beyond +-4: %.3g\n\n", tail);
+}
+
+// --------------------------------------------------------------------------
+// QUALITY: whole core, one kernel per quality level
+// --------------------------------------------------------------------------
+
+tape::TapeLine benchTape;
+
+// Behaviour checks marked FAIL; any makes tape_bench exit 1
+int failures = 0;
+
+// Knob settings for the whole-core suites
+tape::ControlFrame BenchControls() {
+    tape::ControlFrame ctl;
+    ctl.time = 0.35f;
+    ctl.feedback = 0.5f;
+    ctl.mix = 0.5f;
+    ctl.tone = 0.7f;
+    ctl.flutter = 0.1f;
+    return ctl;
+}
+
+// ns per stereo sample of core.Process() over the input, `block` at a time
+double TimeCore(tape::TapeDelayCore &core, const tape::ControlFrame &ctl, size_t block,
+                const std::vector<float> &inL, const std::vector<float> &inR,
+                std::vector<float> &outL, std::vector<float> &outR) {
+    const size_t blocks = inL.size() / block;
+    return host::NsPerBlock(inL.size(), [&]() {
+        for (size_t b = 0; b < blocks; b++) {
+            const float *in[2] = {inL.data() + b * block, inR.data() + b * block};
+            float *out[2] = {outL.data() + b * block, outR.data() + b * block};
+            core.Process(ctl, in, out, block);
+        }
+        host::Consume(outL.data(), outL.size());
+    }, 5);
+}
+
+void SuiteQuality() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    printf("== quality: TapeDelayCore::Process per quality and oversampling factor\n"
+           "   (ns per stereo sample, block %zu, noise input, feedback 0.5)\n", block);
+    std::vector<float> inL = host::UniformNoise(block * blocks, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(block * blocks, 0.5f, 2);
+    std::vector<float> outL(inL.size()), outR(inR.size());
+
+    const char *qnames[] = {"q0 LUT cosine", "q1 LUT cubic + env", "q2 realtime + env"};
+    const char *nlnames[] = {"tanh", "poly", "cubic", "parabolic"};
+    printf("%-30s %10s %10s %10s\n", "kernel", "1x", "2x", "4x");
+    static tape::TapeDelayCore core;
+    for (int q = 0; q < tape::QUALITY_COUNT; q++) {
+        // The table holds the curve below quality 2, so one curve is enough there
+        const int curves = (q == tape::QUALITY_REALTIME) ? tape::NONLIN_COUNT : 1;
+        for (int nl = 0; nl < curves; nl++) {
+            double ns[3];
+            const int factors[3] = {1, 2, 4};
+            for (int f = 0; f < 3; f++) {
+                core.Init(48000.0f, &benchTape);
+                core.SetNonlin(nl);
+                core.SetQuality(q);
+                core.SetOversampling(factors[f]);
+                ns[f] = TimeCore(core, BenchControls(), block, inL, inR, outL, outR);
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "%s (%s)", qnames[q], nlnames[nl]);
+            printf("%-30s %10.2f %10.2f %10.2f\n", label, ns[0], ns[1], ns[2]);
+        }
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// MODES: whole core per head mode, forwards and in reverse
+// --------------------------------------------------------------------------
+
+void SuiteModes() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    printf("== modes: TapeDelayCore::Process per head mode (ns per stereo sample,\n"
+           "   block %zu, q0 1x, noise input, feedback 0.5)\n", block);
+    std::vector<float> inL = host::UniformNoise(block * blocks, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(block * blocks, 0.5f, 2);
+    std::vector<float> outL(inL.size()), outR(inR.size());
+
+    // Heads each mode plays, as in TapeCore.cpp
+    const char *heads[] = {"", "1", "2", "3", "2+3", "1", "2", "3", "1+2", "2+3", "1+3", "1+2+3", "none"};
+    printf("%-30s %10s %10s\n", "mode (heads)", "forward", "reverse");
+    static tape::TapeDelayCore core;
+    for (int mode = 1; mode <= HEAD_MODE_COUNT; mode++) {
+        double ns[2];
+        for (int rev = 0; rev < 2; rev++) {
+            core.Init(48000.0f, &benchTape);
+            core.SetHeadMode(mode);
+            tape::ControlFrame ctl = BenchControls();
+            if (rev) {
+                // One block to press D2
+                ctl.reverse_pressed = true;
+                const float *in[2] = {inL.data(), inR.data()};
+                float *out[2] = {outL.data(), outR.data()};
+                core.Process(ctl, in, out, block);
+                ctl.reverse_pressed = false;
+            }
+            ns[rev] = TimeCore(core, ctl, block, inL, inR, outL, outR);
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "%2d (%s)", mode, heads[mode]);
+        printf("%-30s %10.2f %10.2f\n", label, ns[0], ns[1]);
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// HOLD: whole core playing vs held (tape stopped, one loop read)
+// --------------------------------------------------------------------------
+
+void SuiteHold() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    printf("== hold: TapeDelayCore::Process playing and held (ns per stereo sample,\n"
+           "   block %zu, noise input, feedback 0.5)\n", block);
+    std::vector<float> inL = host::UniformNoise(block * blocks, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(block * blocks, 0.5f, 2);
+    std::vector<float> outL(inL.size()), outR(inR.size());
+
+    const int qualities[] = {tape::QUALITY_LUT_COSINE, tape::QUALITY_REALTIME};
+    printf("%-30s %10s %10s\n", "quality", "playing", "held");
+    static tape::TapeDelayCore core;
+    for (int q : qualities) {
+        double ns[2];
+        for (int held = 0; held < 2; held++) {
+            core.Init(48000.0f, &benchTape);
+            core.SetQuality(q);
+            tape::ControlFrame ctl = BenchControls();
+            if (held) {
+                // Press D1, then let the hold fade in fully (~0.5 s)
+                ctl.freeze_pressed = true;
+                const float *in[2] = {inL.data(), inR.data()};
+                float *out[2] = {outL.data(), outR.data()};
+                for (size_t b = 0; b < 1000; b++) {
+                    core.Process(ctl, in, out, block);
+                    ctl.freeze_pressed = false;
+                }
+            }
+            ns[held] = TimeCore(core, ctl, block, inL, inR, outL, outR);
+        }
+        printf("%-30s %10.2f %10.2f\n", q == tape::QUALITY_LUT_COSINE ? "q0 LUT cosine" : "q2 realtime + env",
+               ns[0], ns[1]);
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// OVERSAMPLE: cost, latency and aliasing of the saturator at 1x / 2x / 4x
+// --------------------------------------------------------------------------
+
+tape::Oversampler benchOs;
+
+template <int F>
+float DriveOversampled(float x) {
+    if constexpr (F == 1) {
+        return tape::tnhLam(x * 1.3f);
+    } else {
+        float up[F];
+        benchOs.Up<F>(x, up);
+        for (int k = 0; k < F; k++) up[k] = tape::tnhLam(up[k] * 1.3f);
+        return benchOs.Down<F>(up);
+    }
+}
+
+template <int F>
+float PassOversampled(float x) {
+    if constexpr (F == 1) {
+        return x;
+    } else {
+        float up[F];
+        benchOs.Up<F>(x, up);
+        return benchOs.Down<F>(up);
+    }
+}
+
+// Complex DFT bin of v at `hz` (v is a whole number of periods long)
+void DftBin(const std::vector<float> &v, double hz, double &re, double &im) {
+    re = im = 0.0;
+    for (size_t i = 0; i < v.size(); i++) {
+        double ph = 6.283185307179586 * hz * static_cast<double>(i) / 48000.0;
+        re += v[i] * cos(ph);
+        im -= v[i] * sin(ph);
+    }
+}
+
+template <int F>
+void OversampleRow() {
+    std::vector<float> sweep = host::SineSweep(1 << 16, 2.0f);
+    benchOs.Init();
+    double ns = host::NsPerSample(sweep, [](float x) { return DriveOversampled<F>(x); });
+
+    // Latency: phase of a 1 kHz sine through Up + Down alone
+    const size_t N = 48000;
+    std::vector<float> in(N), out(N);
+    benchOs.Init();
+    for (size_t i = 0; i < N; i++) in[i] = sinf(6.2831853f * 1000.0f * i / 48000.0f);
+    for (size_t i = 0; i < N; i++) out[i] = PassOversampled<F>(in[i]);
+    double ir, ii, orr, oi;
+    DftBin(in, 1000.0, ir, ii);
+    DftBin(out, 1000.0, orr, oi);
+    double dphi = atan2(ii, ir) - atan2(oi, orr);
+    while (dphi < 0.0) dphi += 6.283185307179586;
+    double latency = dphi / 6.283185307179586 * 48.0;
+
+    // Aliasing: a hard-driven 4567 Hz sine; everything that is not DC or a
+    // harmonic below Nyquist has been folded back
+    const double f0 = 4567.0;
+    benchOs.Init();
+    for (size_t i = 0; i < 4800; i++) DriveOversampled<F>(sinf(6.2831853f * f0 * i / 48000.0f) * 2.0f);
+    for (size_t i = 0; i < N; i++) {
+        out[i] = DriveOversampled<F>(static_cast<float>(sin(6.283185307179586 * f0 * (i + 4800) / 48000.0)) * 2.0f);
+    }
+    double total = 0.0;
+    for (float v : out) total += static_cast<double>(v) * v;
+    double harmonic = 0.0, re, im;
+    for (double h = 0.0; h < 24000.0; h += f0) {
+        DftBin(out, h, re, im);
+        harmonic += (h == 0.0 ? 1.0 : 2.0) * (re * re + im * im) / N;
+    }
+    double alias_db = 10.0 * log10(fmax(total - harmonic, 1e-30) / total);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%dx tnhLam", F);
+    printf("%-30s %10.2f %12.2f %12.1f\n", label, ns, latency, alias_db);
+}
+
+void SuiteOversample() {
+    printf("== oversample: tnhLam(x * 1.3) through Up/Down (sweep input; latency in\n"
+           "   samples at 1 kHz; alias power vs total for a +6 dB 4567 Hz sine)\n");
+    printf("%-30s %10s %12s %12s\n", "kernel", "ns/sample", "latency", "alias dB");
+    OversampleRow<1>();
+    OversampleRow<2>();
+    OversampleRow<4>();
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// TAPE: two separate delay lines vs one interleaved stereo tape
+// --------------------------------------------------------------------------
+
+tape::DelayLine<float, MAX_DELAY> benchLines[2];
+tape::StereoTape<MAX_DELAY, float> benchTapeF32;
+tape::StereoTape<MAX_DELAY, int16_t> benchTapeI16;
+
+// The core's tape traffic over a whole signal: per block, a stereo read
+// through interpolator I at delay[i] - (i + 1) for each sample (in place, or
+// through a staged copy of the block's span as TapeDelayCore does), then the
+// L/R writes
+template <typename I = tape::InterpHermite, typename Tape>
+void RunTape(Tape &tp, bool staged, const std::vector<float> &in, const std::vector<float> &delay,
+             size_t block, std::vector<float> &outL, std::vector<float> &outR) {
+    using S = typename Tape::Sample;
+    static tape::ReadPrefetch prefetch;
+    std::vector<float> neg(block);
+    for (size_t b = 0; b + block <= in.size(); b += block) {
+        const S *src = nullptr;
+        int32_t first = 0;
+        size_t count = 0;
+        if (staged) {
+            float lo = delay[b], hi = 0.0f;
+            for (size_t i = 0; i < block; i++) {
+                const float d = delay[b + i] - static_cast<float>(i + 1);
+                lo = (d < lo) ? d : lo;
+                hi = (d > hi) ? d : hi;
+            }
+            first = static_cast<int32_t>(lo) - 1;
+            count = static_cast<size_t>(static_cast<int32_t>(hi) + 3 - first);
+            src = tp.Frames(first, count);
+        }
+        if (src) {
+            prefetch.Start(src, count * 2 * sizeof(S));
+            prefetch.Wait();
+            tape::TapeWindow<S> window = {static_cast<const S *>(prefetch.Staging()), first};
+            for (size_t i = 0; i < block; i++) {
+                window.template Read<I>(delay[b + i] - static_cast<float>(i + 1), outL[b + i], outR[b + i]);
+            }
+        } else {
+            for (size_t i = 0; i < block; i++) {
+                tp.template Read<I>(delay[b + i] - static_cast<float>(i + 1), outL[b + i], outR[b + i]);
+            }
+        }
+        tp.WriteBlock(0, 0, &in[b], block);
+        for (size_t i = 0; i < block; i++) neg[i] = -in[b + i];
+        tp.WriteBlock(1, STEREO_OFFSET, neg.data(), block);
+        tp.Advance(block);
+    }
+}
+
+// 0.5 s delay with a little flutter
+std::vector<float> TapeDelayCurve(size_t frames) {
+    std::vector<float> delay(frames);
+    for (size_t i = 0; i < frames; i++) {
+        delay[i] = 24000.0f + 30.0f * sinf(6.2831853f * 0.5f * static_cast<float>(i) / 48000.0f);
+    }
+    return delay;
+}
+
+void SuiteTape() {
+    const size_t block = 48;
+    const size_t frames = (1 << 16) / block * block;
+    printf("== tape: per stereo frame, block %zu: write L/R + Hermite read L/R at a\n"
+           "   flutter-modulated 0.5 s delay (R +%zu), buffers of %zu frames\n",
+           block, STEREO_OFFSET, MAX_DELAY);
+    std::vector<float> in = host::UniformNoise(frames, 0.5f, 3);
+    std::vector<float> delay = TapeDelayCurve(frames);
+    std::vector<float> outL(frames), outR(frames);
+    printf("%-30s %10s\n", "layout", "ns/frame");
+
+    benchLines[0].Init();
+    benchLines[1].Init();
+    double separate = host::NsPerBlock(frames, [&]() {
+        for (size_t b = 0; b < frames; b += block) {
+            for (size_t i = 0; i < block; i++) {
+                const float d = delay[b + i] - static_cast<float>(i + 1);
+                outL[b + i] = benchLines[0].ReadHermite(d);
+                outR[b + i] = benchLines[1].ReadHermite(d + static_cast<float>(STEREO_OFFSET));
+            }
+            for (size_t i = 0; i < block; i++) {
+                benchLines[0].Write(in[b + i]);
+                benchLines[1].Write(-in[b + i]);
+            }
+        }
+        host::Consume(outL.data(), frames);
+    });
+    printf("%-30s %10.2f\n", "2x DelayLine (before)", separate);
+
+    auto row = [&](const char *name, auto &tp, bool staged) {
+        tp.Init();
+        double ns = host::NsPerBlock(frames, [&]() {
+            RunTape(tp, staged, in, delay, block, outL, outR);
+            host::Consume(outL.data(), frames);
+        });
+        printf("%-30s %10.2f\n", name, ns);
+    };
+    row("StereoTape float", benchTapeF32, false);
+    row("StereoTape float, staged", benchTapeF32, true);
+    row("StereoTape int16", benchTapeI16, false);
+    row("StereoTape int16, staged", benchTapeI16, true);
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// FORMAT: what the int16 tape adds to the signal
+// --------------------------------------------------------------------------
+
+void SuiteFormat() {
+    const size_t block = 48;
+    const size_t frames = 4 * 48000 / block * block;
+    printf("== format: int16 tape reads against the float tape (same Hermite reads as\n"
+           "   `tape`; error and signal in dB re full scale 1.0, first second skipped)\n");
+    printf("%-30s %10s %12s %10s\n", "signal", "signal dB", "error dB", "SNR dB");
+
+    std::vector<float> delay = TapeDelayCurve(frames);
+    std::vector<float> refL(frames), refR(frames), outL(frames), outR(frames);
+    struct Signal {
+        const char *name;
+        std::vector<float> in;
+    };
+    const Signal signals[] = {
+        {"sine sweep -6 dB", host::SineSweep(frames, 0.5f)},
+        {"sine sweep -40 dB", host::SineSweep(frames, 0.01f)},
+        {"noise -6 dB peak", host::UniformNoise(frames, 0.5f, 5)},
+        {"sine sweep +12 dB (clips)", host::SineSweep(frames, 4.0f)},
+    };
+    for (const Signal &sig : signals) {
+        benchTapeF32.Init();
+        benchTapeI16.Init();
+        RunTape(benchTapeF32, false, sig.in, delay, block, refL, refR);
+        RunTape(benchTapeI16, false, sig.in, delay, block, outL, outR);
+        double sp = 0.0, ep = 0.0;
+        size_t cnt = 0;
+        for (size_t i = 48000; i < frames; i++) {
+            const double e = outL[i] - refL[i];
+            sp += static_cast<double>(refL[i]) * refL[i];
+            ep += e * e;
+            cnt++;
+        }
+        const double sig_db = 10.0 * log10(sp / cnt + 1e-30);
+        const double err_db = 10.0 * log10(ep / cnt + 1e-30);
+        printf("%-30s %10.1f %12.1f %10.1f\n", sig.name, sig_db, err_db, sig_db - err_db);
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// INTERP: the tape head interpolators, alone and picked per block in the core
+// --------------------------------------------------------------------------
+
+// One row: ns per stereo frame at a static and a fluttered delay, and the
+// error against Hermite under flutter
+template <typename I>
+void InterpRow(const char *name, const std::vector<float> &in, const std::vector<float> &still,
+               const std::vector<float> &flutter, const std::vector<float> &ref, size_t block) {
+    std::vector<float> outL(in.size()), outR(in.size());
+    double ns[2];
+    for (int k = 0; k < 2; k++) {
+        benchTapeF32.Init();
+        ns[k] = host::NsPerBlock(in.size(), [&]() {
+            RunTape<I>(benchTapeF32, true, in, k ? flutter : still, block, outL, outR);
+            host::Consume(outL.data(), outL.size());
+        });
+    }
+    benchTapeF32.Init();
+    RunTape<I>(benchTapeF32, true, in, flutter, block, outL, outR);
+    double ep = 0.0;
+    for (size_t i = 48000; i < in.size(); i++) ep += (outL[i] - ref[i]) * (outL[i] - ref[i]);
+    const double err_db = 10.0 * log10(ep / static_cast<double>(in.size() - 48000) + 1e-30);
+    printf("%-30s %10.2f %10.2f %12.1f\n", name, ns[0], ns[1], err_db);
+}
+
+void SuiteInterp() {
+    const size_t block = 48;
+    const size_t frames = 4 * 48000 / block * block;
+    printf("== interp: stereo tape reads per interpolator, block %zu, ns per frame at a\n"
+           "   static 0.5 s delay and under flutter; error vs Hermite (dB re 1.0, sine\n"
+           "   sweep -6 dB, first second skipped)\n", block);
+    const std::vector<float> in = host::SineSweep(frames, 0.5f);
+    const std::vector<float> still(frames, 24000.0f);
+    const std::vector<float> flutter = TapeDelayCurve(frames);
+    std::vector<float> refL(frames), refR(frames);
+    benchTapeF32.Init();
+    RunTape<tape::InterpHermite>(benchTapeF32, true, in, flutter, block, refL, refR);
+
+    printf("%-30s %10s %10s %12s\n", "interpolator", "static", "flutter", "err dB");
+    InterpRow<tape::InterpNone>("none (1 tap)", in, still, flutter, refL, block);
+    InterpRow<tape::InterpLinear>("linear (2 taps)", in, still, flutter, refL, block);
+    InterpRow<tape::InterpCosine>("cosine (2 taps)", in, still, flutter, refL, block);
+    InterpRow<tape::InterpCubic>("cubic (4 taps)", in, still, flutter, refL, block);
+    InterpRow<tape::InterpHermite>("Hermite (4 taps)", in, still, flutter, refL, block);
+
+    // The whole core: auto against Hermite everywhere
+    const size_t blocks = 2000;
+    std::vector<float> inL = host::UniformNoise(block * blocks, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(block * blocks, 0.5f, 2);
+    std::vector<float> outL(inL.size()), outR(inR.size());
+    printf("\nTapeDelayCore::Process, ns per stereo sample (noise input, feedback 0.5)\n");
+    printf("%-30s %10s %10s\n", "setting", "Hermite", "auto");
+    struct Setting {
+        const char *name;
+        float flutter;
+        int mode;
+    };
+    const Setting settings[] = {
+        {"static, mode 1", 0.0f, 1},
+        {"static, mode 11 (3 heads)", 0.0f, 11},
+        {"flutter 0.1, mode 1", 0.1f, 1},
+    };
+    static tape::TapeDelayCore core;
+    for (const Setting &st : settings) {
+        tape::ControlFrame ctl = BenchControls();
+        ctl.flutter = st.flutter;
+        double ns[2];
+        for (int k = 0; k < 2; k++) {
+            core.Init(48000.0f, &benchTape);
+            core.SetHeadMode(st.mode);
+            core.SetInterp(k ? tape::INTERP_AUTO : tape::INTERP_HERMITE);
+            // Let the delay glide in from its start before timing
+            for (int settle = 0; settle < 4; settle++) TimeCore(core, ctl, block, inL, inR, outL, outR);
+            ns[k] = TimeCore(core, ctl, block, inL, inR, outL, outR);
+        }
+        printf("%-30s %10.2f %10.2f\n", st.name, ns[0], ns[1]);
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// GLIDE: the delay time's per-sample one-pole against the per-block Glide
+// --------------------------------------------------------------------------
+
+void SuiteGlide() {
+    const size_t block = 48;
+    const size_t blocks = 4000;
+    const size_t frames = block * blocks;
+    printf("== glide: read positions for a block from the delay target, ns per\n"
+           "   sample, block %zu; a 24000 -> 5700 sample jump with the wobble of\n"
+           "   `tape` on top, and how far the block ramps stray from the curve\n", block);
+    std::vector<float> wobble = TapeDelayCurve(frames);
+    for (float &w : wobble) w -= 24000.0f;
+    std::vector<float> read(frames);
+    const float target = 5700.0f;
+
+    // Before: fonepole per sample on target + wobble
+    double ns_pole = host::NsPerBlock(frames, [&]() {
+        float cd = 24000.0f;
+        for (size_t b = 0; b < frames; b += block) {
+            for (size_t i = 0; i < block; i++) {
+                tape::fonepole(cd, tape::fclamp(target + wobble[b + i], 10.0f, 143850.0f), 0.0005f);
+                read[b + i] = cd - static_cast<float>(i + 1);
+            }
+        }
+        host::Consume(read.data(), frames);
+    });
+    std::vector<float> curve(read);
+
+    tape::Glide glide;
+    glide.Init(48000.0f, DELAY_GLIDE_MS);
+    double ns_glide = host::NsPerBlock(frames, [&]() {
+        glide.Reset(24000.0f);
+        for (size_t b = 0; b < frames; b += block) {
+            const tape::Ramp r = glide.Advance(target, block, 0.001f);
+            for (size_t i = 0; i < block; i++) {
+                read[b + i] = r.At(i) + wobble[b + i] - static_cast<float>(i + 1);
+            }
+        }
+        host::Consume(read.data(), frames);
+    });
+
+    // Against the exact curve, wobble left out (the one-pole filtered it)
+    double worst = 0.0;
+    glide.Reset(24000.0f);
+    double exact = 24000.0;
+    const double keep = exp(-1000.0 / (DELAY_GLIDE_MS * 48000.0));
+    for (size_t b = 0; b < frames; b += block) {
+        const tape::Ramp r = glide.Advance(target, block, 0.001f);
+        for (size_t i = 0; i < block; i++) {
+            exact = target + (exact - target) * keep;
+            worst = fmax(worst, fabs(r.At(i) - exact));
+        }
+    }
+    printf("%-30s %10s %12s\n", "kernel", "ns/sample", "max off");
+    printf("%-30s %10.2f %12s\n", "fonepole per sample (before)", ns_pole, "-");
+    printf("%-30s %10.2f %12.3f\n", "Glide ramp per block", ns_glide, worst);
+    printf("\n");
+
+    // The reverse head rides on the flutter only, never on the glide: with
+    // the glide in it (or a stale wobble with the flutter off) it sticks at
+    // the write head for part of each loop and plays the tape late. The loop
+    // starts at the newest frame and runs back one frame per sample, so an
+    // impulse recorded 3000 samples before the press plays about 3000 in.
+    printf("   reverse loop (style 1, feedback 0): where an impulse recorded 3000\n"
+           "   samples before the press plays, from the press (about 3000)\n");
+    printf("%-30s %10s %12s\n", "flutter", "sample", "");
+    static tape::TapeDelayCore core;
+    const size_t press = 48000;
+    std::vector<float> inL(press * 2), inR(press * 2);
+    inL[press - 3000] = inR[press - 3000] = 0.5f;
+    std::vector<float> outL(inL.size()), outR(inR.size());
+    for (float flutter : {0.0f, 0.1f}) {
+        core.Init(48000.0f, &benchTape);
+        core.SetReverseStyle(tape::REVERSE_LOOP);
+        tape::ControlFrame ctl = BenchControls();
+        ctl.feedback = 0.0f;
+        ctl.mix = 1.0f;
+        ctl.flutter = flutter;
+        for (size_t b = 0; b < inL.size(); b += block) {
+            ctl.reverse_pressed = (b == press);
+            const float *in[2] = {inL.data() + b, inR.data() + b};
+            float *out[2] = {outL.data() + b, outR.data() + b};
+            core.Process(ctl, in, out, block);
+        }
+        size_t peak = press;
+        for (size_t i = press; i < inL.size(); i++) {
+            if (fabsf(outL[i]) > fabsf(outL[peak])) peak = i;
+        }
+        const long at = static_cast<long>(peak - press);
+        const bool ok = labs(at - 3000) < 16;
+        if (!ok) failures++;
+        printf("%-30.1f %10ld %12s\n", flutter, at, ok ? "ok" : "FAIL");
+    }
+    printf("\n");
+}
+
+struct Suite {
+    const char *name;
+    void (*run)();
+};
+
+// --------------------------------------------------------------------------
+// DYNAMICS: the envelope and feeder stages on their own
+// --------------------------------------------------------------------------
+
+void SuiteDynamics() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    const size_t samples = block * blocks;
+    printf("== dynamics: per stereo sample, block %zu, noise input\n", block);
+    std::vector<float> inL = host::UniformNoise(samples, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(samples, 0.5f, 2);
+    std::vector<float> pre(block), post(block), mod(block);
+
+    static tape::SatEnvelope env;
+    env.Init(48000.0f);
+    env.SetParams(SAT_CHARACTER, 0.3f);
+    const double ns = host::NsPerBlock(samples, [&]() {
+        for (size_t b = 0; b < blocks; b++) {
+            env.Process(inL.data() + b * block, inR.data() + b * block, pre.data(), post.data(), mod.data(), block);
+            host::Consume(pre.data(), block);
+        }
+    });
+
+    static tape::FeederExpander feeder[2];
+    feeder[0].Init(48000.0f, 0.001f, 0.0002f);
+    feeder[1].Init(48000.0f, 0.0002f, 0.0002f);
+    const double ns_feed = host::NsPerBlock(samples, [&]() {
+        for (size_t b = 0; b < blocks; b++) {
+            feeder[0].Process(inL.data() + b * block, pre.data(), block);
+            feeder[1].Process(inR.data() + b * block, post.data(), block);
+            host::Consume(pre.data(), block);
+            host::Consume(post.data(), block);
+        }
+    });
+    printf("%-30s %10s\n", "kernel", "ns/sample");
+    printf("%-30s %10.2f\n", "SatEnvelope (intensity 0.3)", ns);
+    printf("%-30s %10.2f\n", "FeederExpander (both sides)", ns_feed);
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// FLUTTER: the old pair of per-sample LFOs against FlutterMod
+// --------------------------------------------------------------------------
+
+void SuiteFlutter() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    const size_t samples = block * blocks;
+    printf("== flutter: wobble generation per sample, block %zu (depth in samples)\n", block);
+    std::vector<float> wobble(block), skew(block);
+
+    tape::Oscillator lfo, lfo2;
+    lfo.Init(48000.0f);
+    lfo.SetFreq(0.4f);
+    lfo.SetAmp(1.0f);
+    lfo2.Init(48000.0f);
+    lfo2.SetFreq(3.5f);
+    lfo2.SetAmp(0.3f);
+    lfo2.SetWaveform(tape::Oscillator::WAVE_TRI);
+    const double ns_lfo = host::NsPerBlock(samples, [&]() {
+        for (size_t b = 0; b < blocks; b++) {
+            for (size_t i = 0; i < block; i++) wobble[i] = (lfo.Process() + lfo2.Process() * 0.5f) * 30.0f;
+            host::Consume(wobble.data(), block);
+        }
+    });
+
+    tape::FlutterMod mod;
+    mod.Init(48000.0f);
+    printf("%-30s %10s\n", "kernel", "ns/sample");
+    printf("%-30s %10.2f\n", "2x Oscillator (old)", ns_lfo);
+    const float depths[] = {0.0f, 30.0f};
+    for (float depth : depths) {
+        const double ns = host::NsPerBlock(samples, [&]() {
+            for (size_t b = 0; b < blocks; b++) {
+                mod.Process({depth, 0.0f}, wobble.data(), skew.data(), block);
+                host::Consume(wobble.data(), block);
+            }
+        });
+        char label[64];
+        snprintf(label, sizeof(label), "FlutterMod depth %.0f", depth);
+        printf("%-30s %10.2f\n", label, ns);
+    }
+
+    // Peak wobble and right-head skew over 20 s at depth 1
+    mod.Init(48000.0f);
+    float peak = 0.0f, peak_skew = 0.0f;
+    for (size_t b = 0; b < 20 * 48000 / block; b++) {
+        mod.Process({1.0f, 0.0f}, wobble.data(), skew.data(), block);
+        for (size_t i = 0; i < block; i++) {
+            peak = std::max(peak, std::fabs(wobble[i]));
+            peak_skew = std::max(peak_skew, std::fabs(skew[i]));
+        }
+    }
+    printf("depth 1: peak wobble %.3f, peak right-head skew %.3f\n\n", peak, peak_skew);
+}
+
+// --------------------------------------------------------------------------
+// TOPOLOGY: trap filter kernels, cached coefficients vs gen~ per sample
+// --------------------------------------------------------------------------
+
+// The gen~ topologies as the patch runs them, every coefficient recomputed
+// every sample (at roughly where TrapDesign puts them for intensity 0.5)
+struct GenTrap {
+    tape::OnePole6dB lp, hp;
+    tape::PoleZeroLP pz;
+    tape::LoresHipass lores;
+    tape::SallenKey sk1, sk2;
+    // Cutoffs and resonances, set at run time so nothing is folded away
+    float f1 = 0.0f, f2 = 0.0f, r1 = 0.0f, r2 = 0.0f;
+
+    template <int T>
+    float Process(float x) {
+        const float sr = 48000.0f;
+        if constexpr (T == tape::TOPOLOGY_LOFI) {
+            tape::PoleZeroCoeff c;
+            c.Set(f1, sr);
+            tape::LoresCoeff lc;
+            lc.Set(f2, r2, sr);
+            return lores.Process(pz.Process(x, c), lc);
+        } else if constexpr (T == tape::TOPOLOGY_OLD) {
+            tape::SallenKeyCoeff c;
+            c.Set(f1, r1, sr);
+            return hp.Process(sk1.Process<0>(x, c) * 0.922571f, f2, 1);
+        } else if constexpr (T == tape::TOPOLOGY_DARK) {
+            tape::SallenKeyCoeff c, c2;
+            c.Set(f1, r1, sr);
+            c2.Set(f2, r2, sr);
+            const float y = sk2.Process<1>(sk1.Process<0>(x, c) * 0.822243f, c2);
+            return tape::simpSat(y * 0.822243f) * 0.906776f;
+        } else {
+            return hp.Process(lp.Process(x, f1, 0), f2, 1);
+        }
+    }
+};
+
+void SuiteTopology() {
+    const size_t block = 48;
+    const size_t blocks = 2000;
+    const size_t samples = block * blocks;
+    printf("== topology: trap filters per sample (one channel, block %zu, noise input)\n", block);
+    std::vector<float> in = host::UniformNoise(samples, 0.5f, 1);
+    std::vector<float> out(block);
+    const char *names[] = {"201", "LoFi", "Old", "Dark"};
+
+    static tape::TrapDesign design;
+    static tape::TrapFilter filter;
+    static GenTrap gen;
+    printf("%-30s %10s %10s\n", "topology", "kernel", "gen~ style");
+    for (int t = 0; t < tape::TOPOLOGY_COUNT; t++) {
+        design.Init(48000.0f, SAT_CHARACTER);
+        design.SetTopology(t);
+        design.SetTone(2683.0f);
+        design.SetIntensity(0.5f);
+        design.Reset();
+        design.Update(block);
+        filter.Init(48000.0f);
+        double ns = 0.0, ns_gen = 0.0;
+        tape::DispatchTopology(t, [&](auto tp) {
+            constexpr int T = decltype(tp)::value;
+            ns = host::NsPerBlock(samples, [&]() {
+                for (size_t b = 0; b < blocks; b++) {
+                    filter.Process<T>(in.data() + b * block, out.data(), block, design, 0);
+                    host::Consume(out.data(), block);
+                }
+            });
+            const float params[][4] = {
+                {2000.0f, 147.0f, 0.0f, 0.0f},
+                {1545.6f, 4.83f, 0.0f, 0.036f},
+                {3699.0f, 98.0f, 0.18f, 0.0f},
+                {5548.5f, 20.0f, 0.22f, 0.11f},
+            };
+            gen = GenTrap();
+            gen.lp.Init(48000.0f);
+            gen.hp.Init(48000.0f);
+            gen.f1 = params[T][0];
+            gen.f2 = params[T][1];
+            gen.r1 = params[T][2];
+            gen.r2 = params[T][3];
+            ns_gen = host::NsPerBlock(samples, [&]() {
+                for (size_t b = 0; b < blocks; b++) {
+                    for (size_t i = 0; i < block; i++) out[i] = gen.Process<T>(in[b * block + i]);
+                    host::Consume(out.data(), block);
+                }
+            });
+        });
+        printf("%-30s %10.2f %10.2f\n", names[t], ns, ns_gen);
+    }
+
+    // The whole core, and with the Feedback knob sweeping so the
+    // coefficients are recomputed every block
+    std::vector<float> inL = host::UniformNoise(samples, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(samples, 0.5f, 2);
+    std::vector<float> outL(samples), outR(samples);
+    static tape::TapeDelayCore core;
+    printf("%-30s %10s %10s\n", "TapeDelayCore::Process", "steady", "sweeping");
+    for (int t = 0; t < tape::TOPOLOGY_COUNT; t++) {
+        core.Init(48000.0f, &benchTape);
+        core.SetTopology(t);
+        const double steady = TimeCore(core, BenchControls(), block, inL, inR, outL, outR);
+        core.Init(48000.0f, &benchTape);
+        core.SetTopology(t);
+        const double sweeping = host::NsPerBlock(samples, [&]() {
+            tape::ControlFrame ctl = BenchControls();
+            for (size_t b = 0; b < blocks; b++) {
+                ctl.feedback = 0.3f + 0.4f * static_cast<float>(b % 100) / 100.0f;
+                const float *in2[2] = {inL.data() + b * block, inR.data() + b * block};
+                float *out2[2] = {outL.data() + b * block, outR.data() + b * block};
+                core.Process(ctl, in2, out2, block);
+            }
+            host::Consume(outL.data(), samples);
+        }, 5);
+        printf("%-30s %10.2f %10.2f\n", names[t], steady, sweeping);
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// DENORMAL: callback cost along a decaying tail
+// --------------------------------------------------------------------------
+
+void SuiteDenormal() {
+    const float sr = 48000.0f;
+    const size_t block = 48;
+    const size_t seconds = 30, window = 3;
+    const size_t samples = seconds * 48000;
+    const size_t windows = seconds / window;
+    printf("== denormal: ns per stereo sample of each %zu s of a tail: a 0.25 s noise\n"
+           "   burst, then silence (block %zu, q0 1x). The hold case holds from 0.5 s to\n"
+           "   1 s; `ftz` runs under ScopedFlushToZero like the firmware callback.\n",
+           window, block);
+    std::vector<float> inL(samples, 0.0f), inR(samples, 0.0f);
+    const std::vector<float> burstL = host::UniformNoise(12000, 0.5f, 1);
+    const std::vector<float> burstR = host::UniformNoise(12000, 0.5f, 2);
+    std::copy(burstL.begin(), burstL.end(), inL.begin());
+    std::copy(burstR.begin(), burstR.end(), inR.begin());
+    std::vector<float> outL(block), outR(block);
+
+    struct Case {
+        const char *name;
+        int mode, topology;
+        float feedback;
+        bool hold;
+    };
+    const Case cases[] = {
+        {"mode 1", 1, tape::TOPOLOGY_201, 0.5f, false},
+        {"mode 12", 12, tape::TOPOLOGY_201, 0.5f, false},
+        {"Dark", 1, tape::TOPOLOGY_DARK, 0.5f, false},
+        {"hold", 1, tape::TOPOLOGY_201, 0.5f, true},
+    };
+    const size_t case_count = sizeof(cases) / sizeof(cases[0]);
+    static tape::TapeDelayCore core;
+    // ns[case][ftz][window], best of 3 renders
+    std::vector<double> ns(case_count * 2 * windows, 1e30);
+    for (int run = 0; run < 3; run++) {
+        for (size_t c = 0; c < case_count; c++) {
+            for (int ftz = 0; ftz < 2; ftz++) {
+                core.Init(sr, &benchTape);
+                core.SetHeadMode(cases[c].mode);
+                core.SetTopology(cases[c].topology);
+                tape::ControlFrame ctl = BenchControls();
+                ctl.feedback = cases[c].feedback;
+                for (size_t w = 0; w < windows; w++) {
+                    double total = 0.0;
+                    for (size_t b = w * window * 48000; b < (w + 1) * window * 48000; b += block) {
+                        ctl.freeze_pressed = cases[c].hold && (b == 24000 || b == 48000);
+                        const float *in[2] = {inL.data() + b, inR.data() + b};
+                        float *out[2] = {outL.data(), outR.data()};
+                        const auto t0 = std::chrono::steady_clock::now();
+                        if (ftz) {
+                            tape::ScopedFlushToZero guard;
+                            core.Process(ctl, in, out, block);
+                        } else {
+                            core.Process(ctl, in, out, block);
+                        }
+                        total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+                        host::Consume(outL.data(), block);
+                    }
+                    double &best = ns[(c * 2 + ftz) * windows + w];
+                    best = std::min(best, total / static_cast<double>(window * 48000));
+                }
+            }
+        }
+    }
+
+    printf("%-8s", "from s");
+    for (size_t c = 0; c < case_count; c++) printf(" %9s %9s", cases[c].name, "ftz");
+    printf("\n");
+    for (size_t w = 0; w < windows; w++) {
+        printf("%-8zu", w * window);
+        for (size_t c = 0; c < case_count; c++) {
+            printf(" %9.2f %9.2f", ns[(c * 2) * windows + w], ns[(c * 2 + 1) * windows + w]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// BLOCKS: whole core per audio block size, the latency / CPU trade-off
+// --------------------------------------------------------------------------
+
+void SuiteBlocks() {
+    const float sr = 48000.0f;
+    const size_t samples = 48000;
+    const size_t sizes[] = {1, 2, 4, 8, 16, 32, 48, 64, 128, 256};
+    const size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    printf("== blocks: TapeDelayCore::Process per block size (q0 1x, mode 1, noise input,\n"
+           "   feedback 0.5). Latency is the two blocks the codec buffers, load the host\n"
+           "   time against the 48 kHz budget.\n");
+    std::vector<float> inL = host::UniformNoise(samples, 0.5f, 1);
+    std::vector<float> inR = host::UniformNoise(samples, 0.5f, 2);
+    std::vector<float> outL(samples), outR(samples);
+
+    printf("%-10s %10s %12s %10s %10s\n", "block", "latency ms", "ns/callback", "ns/sample", "load %");
+    static tape::TapeDelayCore core;
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (size_t k = 0; k < count; k++) {
+        core.Init(sr, &benchTape);
+        const double ns = TimeCore(core, BenchControls(), sizes[k], inL, inR, outL, outR);
+        const double block = static_cast<double>(sizes[k]);
+        printf("%-10zu %10.2f %12.1f %10.2f %10.2f\n", sizes[k], 2000.0 * block / sr, ns * block, ns,
+               ns * sr * 1e-7);
+        sx += block;
+        sy += ns * block;
+        sxx += block * block;
+        sxy += block * ns * block;
+    }
+    // Least-squares fit of the callback time to a fixed part plus a part per sample
+    const double per_sample = (count * sxy - sx * sy) / (count * sxx - sx * sx);
+    const double fixed = (sy - per_sample * sx) / count;
+    printf("fit: %.1f ns per callback + %.2f ns per sample\n", fixed, per_sample);
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------
+// KERNELS: every DSP primitive on its own, for tracking across revisions
+// --------------------------------------------------------------------------
+
+// Set from the command line (see main)
+const char *json_path = nullptr;
+const char *revision = "unknown";
+// Cortex-M7 cycles per host cycle for this scalar float code: the M7 issues
+// at most one FP op per cycle in order, the host several out of order. A
+// rough default; calibrate it against one PROFILE=stages reading.
+double m7_ratio = 2.0;
+
+// Host clock in GHz, from a chain of dependent adds (one cycle each)
+double HostGhz() {
+    using clock = std::chrono::steady_clock;
+    const uint64_t loops = 1 << 22;
+    double best = 0.0;
+    for (int r = 0; r < 5; r++) {
+        uint64_t x = 0;
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < loops; i++) {
+            for (int k = 0; k < 8; k++) {
+                x += 1;
+                asm volatile("" : "+r"(x));
+            }
+        }
+        auto t1 = clock::now();
+        const double ghz = 8.0 * loops / std::chrono::duration<double, std::nano>(t1 - t0).count();
+        best = (ghz > best) ? ghz : best;
+    }
+    return best;
+}
+
+// n samples from `in` to `out`, with whatever state the kernel keeps
+using KernelRun = std::function<void(const float *in, float *out, size_t n)>;
+
+struct KernelCase {
+    const char *kernel;
+    std::string input;
+    size_t size;                  // delay line length, 0 if none
+    std::vector<float> in;
+    std::function<KernelRun()> make;   // a fresh instance
+    // What the error is against (nullptr: nothing, the kernel is its own
+    // definition), the exact values for `in`, and whether it is relative
+    const char *reference;
+    std::function<std::vector<double>(const std::vector<float> &)> exact;
+    bool relative;
+};
+
+// Per-sample function f as a kernel with no state
+template <typename F>
+std::function<KernelRun()> Stateless(F f) {
+    return [f]() -> KernelRun {
+        return [f](const float *in, float *out, size_t n) {
+            for (size_t i = 0; i < n; i++) out[i] = f(in[i]);
+        };
+    };
+}
+
+// Exact values of a function with no state
+template <typename F>
+std::function<std::vector<double>(const std::vector<float> &)> Exact(F f) {
+    return [f](const std::vector<float> &in) {
+        std::vector<double> v(in.size());
+        for (size_t i = 0; i < in.size(); i++) v[i] = f(static_cast<double>(in[i]));
+        return v;
+    };
+}
+
+// The sweep and the noise, moved from -1..1 to lo..hi
+std::vector<float> Span(std::vector<float> v, float lo, float hi) {
+    for (float &x : v) x = lo + (x + 1.0f) * 0.5f * (hi - lo);
+    return v;
+}
+
+template <size_t N>
+std::function<KernelRun()> HermiteReads() {
+    return []() -> KernelRun {
+        auto line = std::make_shared<tape::DelayLine<float, N>>();
+        line->Init();
+        auto noise = std::make_shared<std::vector<float>>(host::UniformNoise(4096, 0.5f, 9));
+        auto pos = std::make_shared<size_t>(0);
+        return [line, noise, pos](const float *in, float *out, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                line->Write((*noise)[(*pos)++ & 4095]);
+                out[i] = line->ReadHermite(in[i]);
+            }
+        };
+    };
+}
+
+void SuiteKernels() {
+    const size_t frames = 1 << 15;
+    const size_t blocks[] = {8, 48, 256};
+    const float sr = 48000.0f;
+    const double ghz = HostGhz();
+    printf("== kernels: each primitive alone, ns/sample per block size and M7 cycles\n"
+           "   estimated at block 48 (host %.2f GHz x %.2f M7 cycles per host cycle)\n", ghz, m7_ratio);
+
+    const std::vector<float> sweep = host::SineSweep(frames, 1.0f);
+    const std::vector<float> noise = host::UniformNoise(frames, 1.0f, 7);
+    auto tanh_exact = Exact([](double x) { return std::tanh(x); });
+
+    std::vector<KernelCase> cases;
+    for (int k = 0; k < 2; k++) {
+        const std::vector<float> &src = k ? noise : sweep;
+        const char *name = k ? "noise" : "sweep";
+        auto label = [&](const char *range) { return std::string(name) + " " + range; };
+
+        cases.push_back({"tnhLam", label("-4..4"), 0, Span(src, -4.0f, 4.0f),
+                         Stateless([](float x) { return tape::tnhLam(x); }), "tanh", tanh_exact, false});
+        cases.push_back({"polysat", label("-4..4"), 0, Span(src, -4.0f, 4.0f),
+                         Stateless([](float x) { return tape::polysat(x); }), "tanh", tanh_exact, false});
+        cases.push_back({"cnl", label("-4..4"), 0, Span(src, -4.0f, 4.0f),
+                         Stateless([](float x) { return tape::cnl(x); }), "tanh", tanh_exact, false});
+        cases.push_back({"parsat", label("-4..4"), 0, Span(src, -4.0f, 4.0f),
+                         Stateless([](float x) { return tape::parsat(x, 1.0f, 1.0f); }), "tanh", tanh_exact, false});
+        cases.push_back({"softStatic", label("-8..8"), 0, Span(src, -8.0f, 8.0f),
+                         Stateless([](float x) { return tape::softStatic(x); }), nullptr, nullptr, false});
+        cases.push_back({"expA", label("-1..3.5"), 0, Span(src, -1.0f, 3.5f),
+                         Stateless([](float x) { return tape::expA(x); }), "exp(2x)",
+                         Exact([](double x) { return std::exp(2.0 * x); }), true});
+        cases.push_back({"tnA", label("0..0.8"), 0, Span(src, 0.0f, 0.8f),
+                         Stateless([](float x) { return tape::tnA(x); }), "tan",
+                         Exact([](double x) { return std::tan(x); }), false});
+        cases.push_back({"sinApp01", label("0..1"), 0, Span(src, 0.0f, 1.0f),
+                         Stateless([](float x) { return tape::sinApp01(x); }), "sin(2 pi x)",
+                         Exact([](double x) { return std::sin(6.283185307179586 * x); }), false});
+        cases.push_back({"MapLog", label("0..1"), 0, Span(src, 0.0f, 1.0f),
+                         Stateless([](float x) { return tape::MapLog(x, 400.0f, 18000.0f); }), "400 * 45^x",
+                         Exact([](double x) { return 400.0 * std::pow(45.0, x); }), true});
+
+        // One-poles: the exact reference is the same recursion in double
+        cases.push_back({"fonepole", label("-1..1"), 0, src,
+                         []() -> KernelRun {
+                             auto y = std::make_shared<float>(0.0f);
+                             return [y](const float *in, float *out, size_t n) {
+                                 for (size_t i = 0; i < n; i++) {
+                                     tape::fonepole(*y, in[i], 0.0005f);
+                                     out[i] = *y;
+                                 }
+                             };
+                         },
+                         "double", [](const std::vector<float> &in) {
+                             std::vector<double> v(in.size());
+                             double y = 0.0;
+                             for (size_t i = 0; i < in.size(); i++) v[i] = y += 0.0005 * (in[i] - y);
+                             return v;
+                         }, false});
+        auto one_pole_exact = [sr](const std::vector<float> &in) {
+            std::vector<double> v(in.size());
+            const double f = std::sin(2000.0 * 6.283185307179586 / sr);
+            double y = 0.0;
+            for (size_t i = 0; i < in.size(); i++) v[i] = y += f * (in[i] - y);
+            return v;
+        };
+        cases.push_back({"OnePole6dB::Process(cutoff)", label("-1..1"), 0, src,
+                         [sr]() -> KernelRun {
+                             auto f = std::make_shared<tape::OnePole6dB>();
+                             f->Init(sr);
+                             return [f](const float *in, float *out, size_t n) {
+                                 for (size_t i = 0; i < n; i++) out[i] = f->Process(in[i], 2000.0f, 0);
+                             };
+                         },
+                         "double", one_pole_exact, false});
+        cases.push_back({"OnePole6dB::Process(coeff)", label("-1..1"), 0, src,
+                         [sr]() -> KernelRun {
+                             auto f = std::make_shared<tape::OnePole6dB>();
+                             auto c = std::make_shared<tape::OnePoleCoeff>();
+                             f->Init(sr);
+                             c->Init(sr, 2000.0f);
+                             return [f, c](const float *in, float *out, size_t n) {
+                                 for (size_t i = 0; i < n; i++) out[i] = f->Process(in[i], *c, 0);
+                             };
+                         },
+                         "double", one_pole_exact, false});
+    }
+
+    // The oscillator takes no input: 440 Hz so the phase wraps often
+    for (int wf = 0; wf < 2; wf++) {
+        cases.push_back({wf ? "Oscillator (tri)" : "Oscillator (sin)", "440 Hz", 0, sweep,
+                         [sr, wf]() -> KernelRun {
+                             auto osc = std::make_shared<tape::Oscillator>();
+                             osc->Init(sr);
+                             osc->SetFreq(440.0f);
+                             osc->SetAmp(1.0f);
+                             osc->SetWaveform(wf ? tape::Oscillator::WAVE_TRI : tape::Oscillator::WAVE_SIN);
+                             return [osc](const float *, float *out, size_t n) {
+                                 for (size_t i = 0; i < n; i++) out[i] = osc->Process();
+                             };
+                         },
+                         "double", [sr, wf](const std::vector<float> &in) {
+                             std::vector<double> v(in.size());
+                             for (size_t i = 0; i < in.size(); i++) {
+                                 const double ph = std::fmod(440.0 * static_cast<double>(i) / sr, 1.0);
+                                 v[i] = wf ? 2.0 * (std::fabs(2.0 * ph - 1.0) - 0.5) : std::sin(6.283185307179586 * ph);
+                             }
+                             return v;
+                         }, false});
+    }
+
+    // Hermite reads from lines of three lengths, at a fixed delay and a
+    // wobbling one; one write per read, as on the tape
+    auto hermite = [&](size_t size, std::function<KernelRun()> make) {
+        const float mid = static_cast<float>(size) * 0.5f;
+        cases.push_back({"DelayLine::ReadHermite", "static", size,
+                         std::vector<float>(frames, mid + 0.37f), make, nullptr, nullptr, false});
+        cases.push_back({"DelayLine::ReadHermite", "sweep +-100", size,
+                         Span(sweep, mid - 100.0f, mid + 100.0f), make, nullptr, nullptr, false});
+    };
+    hermite(4800, HermiteReads<4800>());
+    hermite(48000, HermiteReads<48000>());
+    hermite(144000, HermiteReads<144000>());
+
+    FILE *json = json_path ? fopen(json_path, "w") : nullptr;
+    if (json_path && !json) fprintf(stderr, "cannot write %s\n", json_path);
+    if (json) {
+        fprintf(json, "{\n  \"suite\": \"kernels\",\n  \"revision\": \"%s\",\n  \"host_ghz\": %.3f,\n"
+                      "  \"m7_ratio\": %.3f,\n  \"results\": [",
+                revision, ghz, m7_ratio);
+    }
+
+    printf("%-28s %-14s %7s %8s %8s %8s %9s %10s %10s\n", "kernel", "input", "size", "ns@8", "ns@48", "ns@256",
+           "M7 cyc", "max err", "rms err");
+    std::vector<float> out(frames);
+    bool first = true;
+    for (const KernelCase &c : cases) {
+        double ns[3];
+        for (int b = 0; b < 3; b++) {
+            const size_t block = blocks[b];
+            KernelRun run = c.make();
+            ns[b] = host::NsPerBlock(frames, [&]() {
+                for (size_t o = 0; o + block <= frames; o += block) run(c.in.data() + o, out.data() + o, block);
+                host::Consume(out.data(), out.size());
+            }, 5);
+        }
+        const double cycles = ns[1] * ghz * m7_ratio;
+
+        // Accuracy from a fresh instance, 48 at a time
+        double max_err = 0.0, sum_sq = 0.0;
+        if (c.exact) {
+            KernelRun run = c.make();
+            for (size_t o = 0; o < frames; o += 48) {
+                run(c.in.data() + o, out.data() + o, std::min<size_t>(48, frames - o));
+            }
+            const std::vector<double> exact = c.exact(c.in);
+            for (size_t i = 0; i < frames; i++) {
+                double e = fabs(out[i] - exact[i]);
+                if (c.relative) e /= fmax(fabs(exact[i]), 1e-30);
+                max_err = fmax(max_err, e);
+                sum_sq += e * e;
+            }
+        }
+        const double rms_err = sqrt(sum_sq / frames);
+
+        char size[24] = "-", max_s[16] = "-", rms_s[16] = "-";
+        if (c.size) snprintf(size, sizeof(size), "%zu", c.size);
+        if (c.exact) {
+            snprintf(max_s, sizeof(max_s), "%.3g%s", max_err, c.relative ? "r" : "");
+            snprintf(rms_s, sizeof(rms_s), "%.3g%s", rms_err, c.relative ? "r" : "");
+        }
+        printf("%-28s %-14s %7s %8.2f %8.2f %8.2f %9.1f %10s %10s\n", c.kernel, c.input.c_str(), size, ns[0], ns[1], ns[2],
+               cycles, max_s, rms_s);
+
+        if (json) {
+            for (int b = 0; b < 3; b++) {
+                fprintf(json, "%s\n    {\"kernel\": \"%s\", \"input\": \"%s\", \"size\": %zu, \"block\": %zu, "
+                              "\"ns_per_sample\": %.3f, \"m7_cycles_est\": %.1f",
+                        first ? "" : ",", c.kernel, c.input.c_str(), c.size, blocks[b], ns[b], ns[b] * ghz * m7_ratio);
+                first = false;
+                if (c.exact) {
+                    fprintf(json, ", \"reference\": \"%s\", \"error\": \"%s\", \"max_err\": %.6g, \"rms_err\": %.6g}",
+                            c.reference, c.relative ? "relative" : "absolute", max_err, rms_err);
+                } else {
+                    fprintf(json, ", \"reference\": null}");
+                }
+            }
+        }
+    }
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+        printf("wrote %s\n", json_path);
+    }
+    printf("(r: relative error; saturators are measured against tanh, i.e. how far\n"
+           " each curve is from it, not an approximation error)\n\n");
+}
+
+const Suite suites[] = {
+    {"sat", SuiteSat},
+    {"quality", SuiteQuality},
+    {"modes", SuiteModes},
+    {"hold", SuiteHold},
+    {"oversample", SuiteOversample},
+    {"tape", SuiteTape},
+    {"format", SuiteFormat},
+    {"flutter", SuiteFlutter},
+    {"dynamics", SuiteDynamics},
+    {"topology", SuiteTopology},
+    {"blocks", SuiteBlocks},
+    {"denormal", SuiteDenormal},
+    {"interp", SuiteInterp},
+    {"glide", SuiteGlide},
+    {"kernels", SuiteKernels},
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<const char *> wanted_names;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--json") && has_value) json_path = argv[++i];
+        else if (!strcmp(argv[i], "--rev") && has_value) revision = argv[++i];
+        else if (!strcmp(argv[i], "--m7-ratio") && has_value) m7_ratio = atof(argv[++i]);
+        else wanted_names.push_back(argv[i]);
+    }
+    bool ran = false;
+    for (const Suite &s : suites) {
+        bool wanted = wanted_names.empty();
+        for (const char *name : wanted_names) wanted |= !strcmp(name, s.name);
+        if (wanted) {
+            s.run();
+            ran = true;
+        }
+    }
+    if (!ran) {
+        fprintf(stderr, "usage: tape_bench [--json FILE] [--rev NAME] [--m7-ratio R] [suite ...]\nsuites:");
+        for (const Suite &s : suites) fprintf(stderr, " %s", s.name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,452 @@
+/**
+ * tape_compare: render a WAV file through TapeDelayCore and through the gen~
+ * reference model (GenReference.h) and report how far apart they are.
+ *
+ *   tape_compare [options] in.wav [core.wav ref.wav]
+ *
+ * Both run from the same MockControls: the core gets the ControlFrames as in
+ * tape_render, and the reference the gen~ Params the core derives from the
+ * same knobs and buttons (Time -> InitialDelay, Feedback -> intensity, Filter
+ * -> freqatten, D1 -> Hold, D2 -> direction, and the mode, topology, quality,
+ * curve and reverse style settings). The reference's in3 is the core's own
+ * flutter wobble, so both tapes move alike. Only the wet signal is compared:
+ * the core runs with the Mix knob fully up, since the dry / wet mix sits
+ * outside the gen~ patch.
+ *
+ * Error metrics per channel, after the settle time: RMS of each side, RMS
+ * and peak of the difference and the signal-to-error ratio, also at the
+ * lag (within --align samples) where the two line up best, and optionally
+ * the ratio per segment of the render to see where they drift apart.
+ *
+ * The core is measured where its echoes are meant to fall against the
+ * reference's (ChannelLag()): one sample early on both sides, because
+ * the core writes the tape before it reads it, as the original firmware did,
+ * where a gen~ Delay reads first; and the right side STEREO_OFFSET
+ * samples late, which the core adds and the patch does not have. Those lags
+ * hold for the first echo only: with feedback each pass round the loop adds
+ * them again (the core's loops are d-1 and d+STEREO_OFFSET samples against
+ * the patch's d), so gate with --min-snr at --feedback 0.
+ *
+ * Three differences between the firmware and the patch are taken out
+ * before the ratio is worth anything:
+ *   - the Filter knob reaches 18 kHz, the patch's freqatten only 0.25..2
+ *     (500..4000 Hz on '201'), so both sides get the knob clamped to the
+ *     range the patch can follow (ToneRange())
+ *   - the core's DC block has its pole at 0.995 (about 38 Hz), genlib's
+ *     dcblock at 0.9997: MatchCore() moves the core's pole over, which
+ *     also takes out the extra phase below 1 kHz
+ *   - quality 0 drives the table at a fixed 1.3 where gen~ scales by
+ *     Amix * doppelAgc into it and Cmix * doppelCompen out of it, about
+ *     1.8 dB less: one gain per channel, fitted by least squares and
+ *     printed, takes that out
+ * The plain ratio is printed as well; --min-snr gates the matched one.
+ * Baseline, about 47 dB on both sides at quality 0 (a 4 s, 440 Hz sine at
+ * 0.3, e.g. from sox -n -r 48000 -c 2 -e floating-point -b 32 sine.wav
+ * synth 4 sine 440 vol 0.3):
+ *
+ *   tape_compare --feedback 0 --flutter 0 --min-snr 40 sine.wav
+ *
+ * Louder input leaves less (about 32 dB at 0.8 peak), since the two
+ * drives reach the knee of the curve at different levels; quality 2 and
+ * the other topologies about 27..30 dB.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../TapeCore.h"
+#include "GenReference.h"
+#include "MockControls.h"
+#include "WavFile.h"
+
+namespace {
+
+// Tape memory; lives in SDRAM on the hardware
+tape::TapeLine tapeMem;
+
+tape::TapeDelayCore core;
+
+void Usage() {
+    fprintf(stderr,
+            "usage: tape_compare [options] in.wav [core.wav ref.wav]\n"
+            "  --block N        audio block size in samples (default 48)\n"
+            "  --time V         Time knob 0..1 (default 0.35)\n"
+            "  --feedback V     Feedback knob 0..1 (default 0.5)\n"
+            "  --tone V         Filter knob 0..1 (default 0.7; clamped to the patch's\n"
+            "                   range, about 0.06..0.60)\n"
+            "  --flutter V      Flutter knob 0..1 (default 0.1)\n"
+            "  --set T KNOB V   move KNOB (time, feedback, tone, flutter) to V at T seconds;\n"
+            "                   repeatable\n"
+            "  --freeze T       press D1 (freeze / Hold) at T seconds; repeatable\n"
+            "  --reverse T      press D2 (reverse) at T seconds; repeatable\n"
+            "  --mode N         head mode 1..12\n"
+            "  --topology N     trap filters: 0 '201', 1 LoFi, 2 Old, 3 Dark\n"
+            "  --reverse-style N  reverse heads: 0 sweep the whole tape, 1 loop over the delay\n"
+            "  --nonlin N       saturation curve: 0 tanh, 1 poly, 2 cubic, 3 parabolic\n"
+            "  --quality N      saturation quality 0..2\n"
+            "  --wow V          gen~ capstan wow 0..1 for the reference (default 0; the\n"
+            "                   core's wow is part of its flutter)\n"
+            "  --on-load        start the reference as gen~ does on load, not settled\n"
+            "  --tail S         render S seconds of silence after the input (default 0)\n"
+            "  --skip S         leave the first S seconds out of the metrics (default 1)\n"
+            "  --align N        also search the best lag within +-N samples of the expected\n"
+            "                   one (default 64)\n"
+            "  --segment S      print the error ratio for every S seconds (default 0, off)\n"
+            "  --min-snr DB     exit with 2 if either channel's matched ratio is below DB\n");
+}
+
+// Filter knob positions that map onto freqatten 0.25..2, the cutoffs the
+// patch can reach (see PanelToGen)
+void ToneRange(float &lo, float &hi) {
+    lo = logf(500.0f / 400.0f) / logf(18000.0f / 400.0f);
+    hi = logf(4000.0f / 400.0f) / logf(18000.0f / 400.0f);
+}
+
+// The gen~ Params the core would be running with, from the same panel
+class PanelToGen {
+  public:
+    void Init(float sample_rate) {
+        sample_rate_ = sample_rate;
+        for (tape::Hysteresis *k : {&time_, &feedback_, &tone_, &flutter_}) k->Init(KNOB_HYSTERESIS);
+        flutterMod_.Init(sample_rate);
+        flutterSmooth_.Init(sample_rate, 0.9995f);
+    }
+
+    // Params and in3 for the block of n samples `ctl` starts
+    void Process(const tape::ControlFrame &ctl, host::GenParams &p, float *noise, size_t n) {
+        if (time_.Process(ctl.time)) {
+            const float raw = tape::fclamp(time_.Value(), 0.0f, 1.0f);
+            p.InitialDelay = 10.0f + (powf(raw, 2.5f) * 1500.0f);
+        }
+        if (feedback_.Process(ctl.feedback)) p.intensity = tape::fclamp(feedback_.Value(), 0.0f, 1.0f);
+        if (tone_.Process(ctl.tone)) p.freqatten = tape::MapLog(tone_.Value(), 400.0f, 18000.0f) / 2000.0f;
+        if (flutter_.Process(ctl.flutter)) flutter_target_ = tape::fclamp(flutter_.Value(), 0.0f, 1.0f) * 60.0f;
+        if (!primed_) {
+            flutterSmooth_.Reset(flutter_target_);
+            primed_ = true;
+        }
+
+        // The buttons as the core toggles them
+        if (ctl.reverse_pressed) {
+            p.direction = p.direction > 0.0 ? 0.0 : 1.0;
+            if (p.direction > 0.0) p.Hold = 0.0;
+        }
+        if (ctl.freeze_pressed) {
+            p.Hold = p.Hold > 0.0 ? 0.0 : 1.0;
+            if (p.Hold > 0.0) p.direction = 0.0;
+        }
+
+        // The core's wobble is extra delay in samples; gen~ adds Flutter to
+        // the read phase, so in3 is the same wobble negated, in ms
+        const tape::Ramp depth = flutterSmooth_.Advance(flutter_target_, n);
+        if (flutterMod_.Process(depth, noise, skew_, n)) {
+            for (size_t i = 0; i < n; i++) noise[i] *= -1000.0f / sample_rate_;
+        } else {
+            for (size_t i = 0; i < n; i++) noise[i] = 0.0f;
+        }
+    }
+
+  private:
+    float sample_rate_ = 48000.0f;
+    tape::Hysteresis time_, feedback_, tone_, flutter_;
+    tape::FlutterMod flutterMod_;
+    tape::Smoother<tape::SmpSmooth> flutterSmooth_;
+    float flutter_target_ = 0.0f;
+    float skew_[MAX_BLOCK_SIZE];
+    bool primed_ = false;
+};
+
+struct Metrics {
+    double rms_core, rms_ref, rms_err, peak_err;
+    double snr;   // dB, reference over error
+};
+
+double Db(double ratio) { return ratio > 0.0 ? 20.0 * log10(ratio) : -INFINITY; }
+
+// a against b over [start, end), with b read `lag` samples later
+Metrics Measure(const std::vector<float> &a, const std::vector<float> &b, size_t start, size_t end, long lag) {
+    double sa = 0.0, sb = 0.0, se = 0.0, peak = 0.0;
+    size_t count = 0;
+    for (size_t i = start; i < end; i++) {
+        const long j = static_cast<long>(i) + lag;
+        if (j < 0 || j >= static_cast<long>(b.size())) continue;
+        const double x = a[i], y = b[static_cast<size_t>(j)];
+        const double e = x - y;
+        sa += x * x;
+        sb += y * y;
+        se += e * e;
+        peak = fabs(e) > peak ? fabs(e) : peak;
+        count++;
+    }
+    const double k = count ? 1.0 / static_cast<double>(count) : 0.0;
+    Metrics m = {sqrt(sa * k), sqrt(sb * k), sqrt(se * k), peak, 0.0};
+    m.snr = m.rms_err > 0.0 ? Db(m.rms_ref / m.rms_err) : INFINITY;
+    return m;
+}
+
+// Where the core's channel ch lines up with the reference's (see the top)
+long ChannelLag(int ch) {
+    return 1 - (ch ? static_cast<long>(STEREO_OFFSET) : 0);
+}
+
+// Lag within +-range of `around` with the least error
+long BestLag(const std::vector<float> &a, const std::vector<float> &b, size_t start, size_t end, long around,
+             long range) {
+    long best = around;
+    double best_err = Measure(a, b, start, end, around).rms_err;
+    for (long lag = around - range; lag <= around + range; lag++) {
+        const double e = Measure(a, b, start, end, lag).rms_err;
+        if (e < best_err) {
+            best_err = e;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+// The core's output with its DC block's pole (0.995, TapeHead) moved to
+// genlib dcblock's (0.9997): y = x - 0.995 x1 + 0.9997 y1 undoes the one
+// and applies the other, both being first differences over a pole
+std::vector<float> MatchCore(const std::vector<float> &core) {
+    std::vector<float> out(core.size());
+    double x1 = 0.0, y1 = 0.0;
+    for (size_t i = 0; i < core.size(); i++) {
+        const double y = core[i] - 0.995 * x1 + 0.9997 * y1;
+        x1 = core[i];
+        y1 = y;
+        out[i] = static_cast<float>(y);
+    }
+    return out;
+}
+
+// Gain on a that best fits b read `lag` samples later over [start, end)
+double MatchGain(const std::vector<float> &a, const std::vector<float> &b, size_t start, size_t end, long lag) {
+    double ab = 0.0, aa = 0.0;
+    for (size_t i = start; i < end; i++) {
+        const long j = static_cast<long>(i) + lag;
+        if (j < 0 || j >= static_cast<long>(b.size())) continue;
+        ab += static_cast<double>(a[i]) * b[static_cast<size_t>(j)];
+        aa += static_cast<double>(a[i]) * a[i];
+    }
+    return aa > 0.0 ? ab / aa : 1.0;
+}
+
+void PrintMetrics(const char *name, const Metrics &m) {
+    fprintf(stdout, "  %-14s core %8.2f dB  ref %8.2f dB  err %8.2f dB  peak err %8.2f dB  ratio %7.2f dB\n",
+            name, Db(m.rms_core), Db(m.rms_ref), Db(m.rms_err), Db(m.peak_err), m.snr);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    host::MockControls controls;
+    size_t block = 48;
+    double tail_sec = 0.0, skip_sec = 1.0, segment_sec = 0.0;
+    long align = 64;
+    double min_snr = -INFINITY;
+    bool settled = true;
+    host::GenParams params;
+    params.character = SAT_CHARACTER;
+    params.hysterisis = FEEDER_DECAY;
+    params.wow = 0.0;
+    params.Mode = 1;
+    int nonlin = tape::NONLIN_TANH;
+    int quality = tape::QUALITY_LUT_COSINE;
+    int reverse_style = tape::REVERSE_LOOP;
+    int head_mode = 1;
+    int topology = tape::TOPOLOGY_201;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> double {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "%s needs a value\n", arg.c_str());
+                exit(1);
+            }
+            return atof(argv[++i]);
+        };
+        if (arg == "--block") block = static_cast<size_t>(value());
+        else if (arg == "--time") controls.time = value();
+        else if (arg == "--feedback") controls.feedback = value();
+        else if (arg == "--tone") controls.tone = value();
+        else if (arg == "--flutter") controls.flutter = value();
+        else if (arg == "--set") {
+            const double t = value();
+            const int knob = (i + 1 < argc) ? host::MockControls::KnobIndex(argv[++i]) : -1;
+            if (knob < 0 || knob == host::MockControls::KNOB_MIX) {
+                fprintf(stderr, "--set needs a time, a knob name (not mix) and a value\n");
+                return 1;
+            }
+            controls.moves.push_back({t, knob, static_cast<float>(value())});
+        }
+        else if (arg == "--freeze") controls.freeze_presses.push_back(value());
+        else if (arg == "--reverse") controls.reverse_presses.push_back(value());
+        else if (arg == "--mode") head_mode = static_cast<int>(value());
+        else if (arg == "--topology") topology = static_cast<int>(value());
+        else if (arg == "--reverse-style") reverse_style = static_cast<int>(value());
+        else if (arg == "--nonlin") nonlin = static_cast<int>(value());
+        else if (arg == "--quality") quality = static_cast<int>(value());
+        else if (arg == "--wow") params.wow = value();
+        else if (arg == "--on-load") settled = false;
+        else if (arg == "--tail") tail_sec = value();
+        else if (arg == "--skip") skip_sec = value();
+        else if (arg == "--align") align = static_cast<long>(value());
+        else if (arg == "--segment") segment_sec = value();
+        else if (arg == "--min-snr") min_snr = value();
+        else if (arg == "-h" || arg == "--help") { Usage(); return 0; }
+        else if (!arg.empty() && arg[0] == '-') { Usage(); return 1; }
+        else files.push_back(arg);
+    }
+    if ((files.size() != 1 && files.size() != 3) || block == 0) {
+        Usage();
+        return 1;
+    }
+
+    std::string error;
+    host::WavReader reader;
+    if (!reader.Open(files[0], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const float sample_rate = static_cast<float>(reader.SampleRate());
+    const size_t in_channels = reader.Channels();
+
+    controls.mix = 1.0f;
+    controls.Init(sample_rate);
+    core.Init(sample_rate, &tapeMem);
+    core.SetNonlin(nonlin);
+    core.SetQuality(quality);
+    core.SetReverseStyle(reverse_style);
+    core.SetHeadMode(head_mode);
+    core.SetTopology(topology);
+    params.nonlin = core.GetNonlin();
+    params.quality = core.GetQuality();
+    params.reversestyle = core.GetReverseStyle();
+    params.Mode = core.GetHeadMode();
+    params.topology = core.GetTopology();
+
+    host::GenReference reference;
+    reference.Init(sample_rate, 4.0, settled);
+    PanelToGen panel;
+    panel.Init(sample_rate);
+    float tone_lo, tone_hi;
+    ToneRange(tone_lo, tone_hi);
+
+    std::vector<float> interleaved_in(block * in_channels);
+    std::vector<float> in_l(block), in_r(block), out_l(block), out_r(block);
+    std::vector<float> ref_l(block), ref_r(block), noise(block);
+    const float *in_bufs[2] = {in_l.data(), in_r.data()};
+    float *out_bufs[2] = {out_l.data(), out_r.data()};
+    std::vector<float> core_out[2], ref_out[2];
+
+    const uint64_t tail_frames = static_cast<uint64_t>(tail_sec * sample_rate);
+    uint64_t tail_done = 0;
+    uint64_t pos = 0;
+    while (true) {
+        size_t got = reader.Read(interleaved_in.data(), block);
+        if (got < block) {
+            size_t pad = block - got;
+            if (tail_done + pad > tail_frames) pad = static_cast<size_t>(tail_frames - tail_done);
+            for (size_t i = got * in_channels; i < (got + pad) * in_channels; i++) interleaved_in[i] = 0.0f;
+            tail_done += pad;
+            got += pad;
+        }
+        if (got == 0) break;
+
+        for (size_t i = 0; i < got; i++) {
+            in_l[i] = interleaved_in[i * in_channels];
+            in_r[i] = interleaved_in[i * in_channels + (in_channels > 1 ? 1 : 0)];
+        }
+        for (size_t i = got; i < block; i++) in_l[i] = in_r[i] = 0.0f;
+
+        tape::ControlFrame ctl = controls.Frame(pos, block);
+        ctl.tone = tape::fclamp(ctl.tone, tone_lo, tone_hi);
+        {
+            tape::ScopedFlushToZero ftz;   // as in the firmware callback
+            core.Process(ctl, in_bufs, out_bufs, block);
+        }
+        // The core splits long callbacks the same way
+        for (size_t offset = 0; offset < block; offset += MAX_BLOCK_SIZE) {
+            const size_t n = (block - offset < MAX_BLOCK_SIZE) ? block - offset : MAX_BLOCK_SIZE;
+            tape::ControlFrame sub = ctl;
+            if (offset > 0) sub.freeze_pressed = sub.reverse_pressed = false;
+            panel.Process(sub, params, noise.data() + offset, n);
+            reference.Process(params, in_l.data() + offset, in_r.data() + offset, noise.data() + offset,
+                              ref_l.data() + offset, ref_r.data() + offset, n);
+        }
+
+        core_out[0].insert(core_out[0].end(), out_l.begin(), out_l.begin() + got);
+        core_out[1].insert(core_out[1].end(), out_r.begin(), out_r.begin() + got);
+        ref_out[0].insert(ref_out[0].end(), ref_l.begin(), ref_l.begin() + got);
+        ref_out[1].insert(ref_out[1].end(), ref_r.begin(), ref_r.begin() + got);
+        pos += got;
+    }
+
+    if (files.size() == 3) {
+        const std::vector<float> *sides[2] = {core_out, ref_out};
+        for (int f = 0; f < 2; f++) {
+            host::WavWriter writer;
+            if (!writer.Open(files[1 + f], reader.SampleRate(), 2, host::WavWriter::Format::FLOAT32, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+            std::vector<float> interleaved(pos * 2);
+            for (size_t i = 0; i < pos; i++) {
+                interleaved[i * 2] = sides[f][0][i];
+                interleaved[i * 2 + 1] = sides[f][1][i];
+            }
+            writer.Write(interleaved.data(), pos);
+            writer.Close();
+        }
+    }
+
+    const size_t start = static_cast<size_t>(skip_sec * sample_rate);
+    if (start >= pos) {
+        fprintf(stderr, "nothing left to compare after the first %.2f s\n", skip_sec);
+        return 1;
+    }
+    fprintf(stdout, "compared %llu frames at %.0f Hz from %.2f s, block %zu\n",
+            static_cast<unsigned long long>(pos - start), sample_rate, skip_sec, block);
+
+    bool pass = true;
+    static const char *const names[2] = {"left", "right"};
+    std::vector<float> matched[2];
+    for (int ch = 0; ch < 2; ch++) {
+        const long expected = ChannelLag(ch);
+        char name[32];
+        snprintf(name, sizeof(name), "%s %+ld", names[ch], expected);
+        PrintMetrics(name, Measure(core_out[ch], ref_out[ch], start, pos, expected));
+
+        matched[ch] = MatchCore(core_out[ch]);
+        const double gain = MatchGain(matched[ch], ref_out[ch], start, pos, expected);
+        for (float &v : matched[ch]) v = static_cast<float>(v * gain);
+        const Metrics m = Measure(matched[ch], ref_out[ch], start, pos, expected);
+        snprintf(name, sizeof(name), "  matched %+.2f", Db(gain));
+        PrintMetrics(name, m);
+        if (m.snr < min_snr) pass = false;
+        if (align > 0) {
+            const long lag = BestLag(matched[ch], ref_out[ch], start, pos, expected, align);
+            if (lag != expected) {
+                char label[32];
+                snprintf(label, sizeof(label), "  at lag %+ld", lag);
+                PrintMetrics(label, Measure(matched[ch], ref_out[ch], start, pos, lag));
+            }
+        }
+    }
+
+    if (segment_sec > 0.0) {
+        const size_t len = static_cast<size_t>(segment_sec * sample_rate);
+        fprintf(stdout, "matched ratio per %.2f s segment (left / right, dB):\n", segment_sec);
+        for (size_t s = start; len > 0 && s < pos; s += len) {
+            const size_t e = (s + len < pos) ? s + len : pos;
+            fprintf(stdout, "  %8.2f s  %7.2f  %7.2f\n", s / sample_rate,
+                    Measure(matched[0], ref_out[0], s, e, ChannelLag(0)).snr,
+                    Measure(matched[1], ref_out[1], s, e, ChannelLag(1)).snr);
+        }
+    }
+    return pass ? 0 : 2;
+}
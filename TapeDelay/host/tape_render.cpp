@@ -0,0 +1,233 @@
+/**
+ * tape_render: run the TapeDelay DSP core over a WAV file on the host.
+ *
+ *   tape_render [options] in.wav out.wav
+ *
+ * The input is streamed through TapeDelayCore::Process() one block at a time,
+ * exactly like the audio callback on the Patch SM, with the panel replaced by
+ * MockControls. Mono inputs are fed to both channels; the output is always
+ * stereo.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../TapeCore.h"
+#include "MockControls.h"
+#include "WavFile.h"
+
+namespace {
+
+// Tape memory; lives in SDRAM on the hardware
+tape::TapeLine tapeMem;
+
+tape::TapeDelayCore core;
+
+void Usage() {
+    fprintf(stderr,
+            "usage: tape_render [options] in.wav out.wav\n"
+            "  --block N        audio block size in samples (default 48)\n"
+            "  --time V         Time knob 0..1 (default 0.35)\n"
+            "  --feedback V     Feedback knob 0..1 (default 0.5)\n"
+            "  --mix V          Mix knob 0..1 (default 0.5)\n"
+            "  --tone V         Filter knob 0..1 (default 0.7)\n"
+            "  --flutter V      Flutter knob 0..1 (default 0.1)\n"
+            "  --set T KNOB V   move KNOB (time, feedback, mix, tone, flutter) to V at T seconds;\n"
+            "                   repeatable\n"
+            "  --jitter A       add uniform ADC noise of peak A to every knob reading\n"
+            "  --clock-bpm V    send a clock to Gate In 1 at V bpm\n"
+            "  --clock-jitter S move each clock edge by up to S samples either way\n"
+            "  --freeze T       press D1 (freeze) at T seconds; repeatable\n"
+            "  --reverse T      press D2 (reverse) at T seconds; repeatable\n"
+            "  --mode N         head mode 1..12 (gen~ Mode selector, see TapeCore.h)\n"
+            "  --topology N     trap filters: 0 '201', 1 LoFi, 2 Old, 3 Dark (see TapeTrap.h)\n"
+            "  --reverse-style N  reverse heads: 0 sweep the whole tape, 1 loop over the delay\n"
+            "  --interp N       tape head interpolation: 0 auto, 1 none, 2 linear, 3 cosine,\n"
+            "                   4 cubic, 5 Hermite (see TapeCore.h)\n"
+            "  --glide MS       time constant of the glide to a new delay time (default 41.7)\n"
+            "  --tail S         render S seconds of silence after the input (default 0)\n"
+            "  --nonlin N       saturation curve: 0 tanh, 1 poly, 2 cubic, 3 parabolic\n"
+            "  --quality N      saturation quality: 0 table/cosine, 1 table/cubic + envelope,\n"
+            "                   2 realtime curves + envelope\n"
+            "  --oversample N   run the saturator at 1x, 2x or 4x the sample rate\n"
+            "  --no-prefetch    read the tape in place instead of through the staging buffer\n"
+            "  --pcm16          write 16-bit PCM instead of 32-bit float\n"
+            "  --profile        print the per-callback CPU load report at the end\n"
+            "  --gates          print the sample each Gate Out pulse starts on\n");
+}
+
+void PrintStats(const char *name, const tape::CpuProfiler::Stats &st) {
+    fprintf(stderr, "  %-10s min %8u  mean %8u  max %8u  p99 %8u\n", name, st.min, st.mean, st.max, st.p99);
+}
+
+void PrintProfile(const tape::CpuProfiler::Report &r) {
+    fprintf(stderr, "cpu load (%s per callback, last %zu callbacks, budget %u):\n",
+            tape::CYCLE_UNIT, tape::CpuProfiler::WINDOW, r.budget);
+    PrintStats("callback", r.total);
+#ifdef TAPE_PROFILE_STAGES
+    for (int s = 0; s < tape::CpuProfiler::STAGE_COUNT; s++) {
+        PrintStats(tape::CpuProfiler::StageName(static_cast<tape::CpuProfiler::Stage>(s)), r.stage[s]);
+    }
+#endif
+    fprintf(stderr, "  load mean %.2f%%  peak %.2f%% (%u)\n", r.load_mean * 100.0f, r.load_peak * 100.0f, r.peak);
+    if (r.prefetch_fails) fprintf(stderr, "  prefetch %u failed copies read in place\n", r.prefetch_fails);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    host::MockControls controls;
+    size_t block = 48;
+    double tail_sec = 0.0;
+    auto format = host::WavWriter::Format::FLOAT32;
+    bool profile = false;
+    bool gates = false;
+    int nonlin = tape::NONLIN_TANH;
+    int quality = tape::QUALITY_LUT_COSINE;
+    int oversample = 1;
+    bool prefetch = true;
+    int reverse_style = tape::REVERSE_LOOP;
+    int head_mode = 1;
+    int topology = tape::TOPOLOGY_201;
+    int interp = tape::INTERP_AUTO;
+    float glide_ms = DELAY_GLIDE_MS;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> double {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "%s needs a value\n", arg.c_str());
+                exit(1);
+            }
+            return atof(argv[++i]);
+        };
+        if (arg == "--block") block = static_cast<size_t>(value());
+        else if (arg == "--time") controls.time = value();
+        else if (arg == "--feedback") controls.feedback = value();
+        else if (arg == "--mix") controls.mix = value();
+        else if (arg == "--tone") controls.tone = value();
+        else if (arg == "--flutter") controls.flutter = value();
+        else if (arg == "--set") {
+            const double t = value();
+            const int knob = (i + 1 < argc) ? host::MockControls::KnobIndex(argv[++i]) : -1;
+            if (knob < 0) {
+                fprintf(stderr, "--set needs a time, a knob name and a value\n");
+                return 1;
+            }
+            controls.moves.push_back({t, knob, static_cast<float>(value())});
+        }
+        else if (arg == "--jitter") controls.jitter = value();
+        else if (arg == "--clock-bpm") controls.clock_bpm = value();
+        else if (arg == "--clock-jitter") controls.clock_jitter = value();
+        else if (arg == "--freeze") controls.freeze_presses.push_back(value());
+        else if (arg == "--reverse") controls.reverse_presses.push_back(value());
+        else if (arg == "--mode") head_mode = static_cast<int>(value());
+        else if (arg == "--topology") topology = static_cast<int>(value());
+        else if (arg == "--reverse-style") reverse_style = static_cast<int>(value());
+        else if (arg == "--interp") interp = static_cast<int>(value());
+        else if (arg == "--glide") glide_ms = static_cast<float>(value());
+        else if (arg == "--tail") tail_sec = value();
+        else if (arg == "--nonlin") nonlin = static_cast<int>(value());
+        else if (arg == "--quality") quality = static_cast<int>(value());
+        else if (arg == "--oversample") oversample = static_cast<int>(value());
+        else if (arg == "--no-prefetch") prefetch = false;
+        else if (arg == "--pcm16") format = host::WavWriter::Format::PCM16;
+        else if (arg == "--profile") profile = true;
+        else if (arg == "--gates") gates = true;
+        else if (arg == "-h" || arg == "--help") { Usage(); return 0; }
+        else if (!arg.empty() && arg[0] == '-') { Usage(); return 1; }
+        else files.push_back(arg);
+    }
+    if (files.size() != 2 || block == 0) {
+        Usage();
+        return 1;
+    }
+
+    std::string error;
+    host::WavReader reader;
+    if (!reader.Open(files[0], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const float sample_rate = static_cast<float>(reader.SampleRate());
+    const size_t in_channels = reader.Channels();
+
+    host::WavWriter writer;
+    if (!writer.Open(files[1], reader.SampleRate(), 2, format, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    controls.Init(sample_rate);
+    core.Init(sample_rate, &tapeMem);
+    core.SetNonlin(nonlin);
+    core.SetQuality(quality);
+    core.SetOversampling(oversample);
+    core.SetReadPrefetch(prefetch);
+    core.SetReverseStyle(reverse_style);
+    core.SetHeadMode(head_mode);
+    core.SetTopology(topology);
+    core.SetInterp(interp);
+    core.SetDelayGlide(glide_ms);
+    core.Profiler().Init(sample_rate, block, 1e9f);
+    tape::CpuProfiler::Report report;
+    bool have_report = false;
+
+    std::vector<float> interleaved_in(block * in_channels);
+    std::vector<float> interleaved_out(block * 2);
+    std::vector<float> in_l(block), in_r(block), out_l(block), out_r(block);
+    const float *in_bufs[2] = {in_l.data(), in_r.data()};
+    float *out_bufs[2] = {out_l.data(), out_r.data()};
+
+    const uint64_t tail_frames = static_cast<uint64_t>(tail_sec * sample_rate);
+    uint64_t tail_done = 0;
+    uint64_t pos = 0;
+    while (true) {
+        size_t got = reader.Read(interleaved_in.data(), block);
+        if (got < block) {
+            // pad the last partial block, then keep going with silence for the tail
+            size_t pad = block - got;
+            if (tail_done + pad > tail_frames) pad = static_cast<size_t>(tail_frames - tail_done);
+            for (size_t i = got * in_channels; i < (got + pad) * in_channels; i++) interleaved_in[i] = 0.0f;
+            tail_done += pad;
+            got += pad;
+        }
+        if (got == 0) break;
+
+        for (size_t i = 0; i < got; i++) {
+            in_l[i] = interleaved_in[i * in_channels];
+            in_r[i] = interleaved_in[i * in_channels + (in_channels > 1 ? 1 : 0)];
+        }
+
+        // the core always sees full-size blocks, the same as the callback
+        for (size_t i = got; i < block; i++) in_l[i] = in_r[i] = 0.0f;
+        tape::ScopedFlushToZero ftz;   // as in the firmware callback
+        core.Profiler().BeginCallback();
+        core.Process(controls.Frame(pos, block), in_bufs, out_bufs, block);
+        core.Profiler().EndCallback();
+        if (profile) have_report |= core.Profiler().Snapshot(report);
+        if (gates && core.GateOffset() >= 0) {
+            fprintf(stderr, "gate %llu\n", static_cast<unsigned long long>(pos) + core.GateOffset());
+        }
+
+        for (size_t i = 0; i < got; i++) {
+            interleaved_out[i * 2] = out_l[i];
+            interleaved_out[i * 2 + 1] = out_r[i];
+        }
+        writer.Write(interleaved_out.data(), got);
+        pos += got;
+    }
+
+    writer.Close();
+    fprintf(stderr, "rendered %llu frames at %.0f Hz, block %zu\n",
+            static_cast<unsigned long long>(pos), sample_rate, block);
+    if (profile) {
+        if (have_report) PrintProfile(report);
+        else fprintf(stderr, "not enough callbacks for a cpu load report\n");
+    }
+    return 0;
+}